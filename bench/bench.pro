@@ -0,0 +1,40 @@
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+QT += multimedia network
+
+TARGET = bench
+
+HEADERS += \
+    ../src/beamsolver.hpp \
+    ../src/board.hpp \
+    ../src/boardsnapshot.hpp \
+    ../src/boardstate.hpp \
+    ../src/dealdatabase.hpp \
+    ../src/layout.hpp \
+    ../src/layoutloader.hpp \
+    ../src/memoryreport.hpp \
+    ../src/replayarchive.hpp \
+    ../src/replaylog.hpp \
+    ../src/rng.hpp \
+    ../src/savegame.hpp \
+    ../src/solver.hpp \
+    ../src/telemetry.hpp \
+    ../src/transpositiontable.hpp \
+    ../src/tile.hpp \
+    ../src/tilekind.hpp \
+    ../src/tilemodel.hpp \
+    ../src/undohistory.hpp \
+    ../src/winestimator.hpp \
+    benchmark.hpp \
+    ordering.hpp \
+    scaling.hpp \
+    stats.hpp
+
+SOURCES += \
+    main.cpp
+
+INCLUDEPATH += ../src
+
+DISTFILES += hardseeds.txt
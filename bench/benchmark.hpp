@@ -0,0 +1,196 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QVector>
+#include <functional>
+#include <vector>
+
+#include "stats.hpp"
+
+/**
+ * @file benchmark.hpp
+ * @brief A small benchmark runner with JSON baselines.
+ *
+ * A benchmark case is a function that performs some work, times the part it
+ * cares about and returns how long it took and how many operations that
+ * covered. The runner repeats each case until a minimum sample time is
+ * reached, collects several independent samples and summarizes them.
+ * Results can be saved as a JSON baseline and compared against on a later
+ * run on the same machine.
+ */
+
+struct Measurement {
+  qint64 nanoseconds = 0;
+  qint64 operations = 0;
+};
+
+struct BenchmarkCase {
+  QString name;
+  std::function<Measurement()> body;
+};
+
+struct BenchmarkResult {
+  QString name;
+  std::vector<double> samples;  // ns per operation, one entry per run
+  Stats::Summary summary;
+};
+
+class BenchmarkRunner {
+ public:
+  void setRuns(int runs) { m_runs = qMax(2, runs); }
+  void setMinSampleTime(qint64 ms) { m_minSampleNs = ms * 1000000; }
+  void setFilter(const QString& filter) { m_filter = filter; }
+
+  void add(const QString& name, std::function<Measurement()> body) {
+    m_cases.append({name, std::move(body)});
+  }
+
+  QVector<BenchmarkResult> run(QTextStream& out) const {
+    QVector<BenchmarkResult> results;
+    for (const BenchmarkCase& c : m_cases) {
+      if (!m_filter.isEmpty() && !c.name.contains(m_filter)) continue;
+
+      sample(c);  // Warm-up, not recorded
+
+      BenchmarkResult r;
+      r.name = c.name;
+      for (int i = 0; i < m_runs; ++i) r.samples.push_back(sample(c));
+      r.summary = Stats::summarize(r.samples);
+      results.append(r);
+
+      out << QString("%1 %2 ns/op  (95% CI %3 .. %4, n=%5)")
+                 .arg(c.name, -32)
+                 .arg(r.summary.mean, 12, 'f', 1)
+                 .arg(r.summary.ciLow, 0, 'f', 1)
+                 .arg(r.summary.ciHigh, 0, 'f', 1)
+                 .arg(r.summary.count)
+          << Qt::endl;
+    }
+    return results;
+  }
+
+  static bool saveBaseline(const QString& path,
+                           const QVector<BenchmarkResult>& results) {
+    QJsonArray benchmarks;
+    for (const BenchmarkResult& r : results) {
+      QJsonArray samples;
+      for (double v : r.samples) samples.append(v);
+      QJsonObject o;
+      o["name"] = r.name;
+      o["unit"] = "ns/op";
+      o["samples"] = samples;
+      o["mean"] = r.summary.mean;
+      o["stddev"] = r.summary.stddev;
+      o["ciLow"] = r.summary.ciLow;
+      o["ciHigh"] = r.summary.ciHigh;
+      benchmarks.append(o);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["host"] = QSysInfo::machineHostName();
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["kernel"] = QSysInfo::kernelVersion();
+    root["benchmarks"] = benchmarks;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    file.write(QJsonDocument(root).toJson());
+    return true;
+  }
+
+  static bool loadBaseline(const QString& path,
+                           QMap<QString, BenchmarkResult>& baseline,
+                           QString* host = nullptr) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) return false;
+
+    QJsonObject root = doc.object();
+    if (host) *host = root["host"].toString();
+    for (const QJsonValue& v : root["benchmarks"].toArray()) {
+      QJsonObject o = v.toObject();
+      BenchmarkResult r;
+      r.name = o["name"].toString();
+      for (const QJsonValue& s : o["samples"].toArray())
+        r.samples.push_back(s.toDouble());
+      r.summary = Stats::summarize(r.samples);
+      baseline.insert(r.name, r);
+    }
+    return true;
+  }
+
+  // Prints a comparison table and returns the number of significant
+  // slowdowns.
+  static int compare(QTextStream& out,
+                     const QMap<QString, BenchmarkResult>& baseline,
+                     const QVector<BenchmarkResult>& results,
+                     double minRelative) {
+    int slowdowns = 0;
+    out << Qt::endl
+        << QString("%1 %2 %3 %4  %5")
+               .arg("benchmark", -32)
+               .arg("baseline", 12)
+               .arg("current", 12)
+               .arg("change", 9)
+               .arg("verdict")
+        << Qt::endl;
+
+    for (const BenchmarkResult& r : results) {
+      auto it = baseline.constFind(r.name);
+      if (it == baseline.constEnd()) {
+        out << QString("%1 %2").arg(r.name, -32).arg("(not in baseline)")
+            << Qt::endl;
+        continue;
+      }
+
+      Stats::Comparison c =
+          Stats::compare(it->summary, r.summary, minRelative);
+      QString verdict = "no significant change";
+      if (c.slower) {
+        verdict = "SLOWER";
+        ++slowdowns;
+      } else if (c.faster) {
+        verdict = "faster";
+      }
+
+      out << QString("%1 %2 %3 %4%  %5")
+                 .arg(r.name, -32)
+                 .arg(it->summary.mean, 12, 'f', 1)
+                 .arg(r.summary.mean, 12, 'f', 1)
+                 .arg((c.ratio - 1.0) * 100.0, 8, 'f', 1)
+                 .arg(verdict)
+          << Qt::endl;
+    }
+    return slowdowns;
+  }
+
+ private:
+  // One sample: run the case until enough time has been measured and
+  // return the average cost of a single operation.
+  double sample(const BenchmarkCase& c) const {
+    Measurement total;
+    while (total.nanoseconds < m_minSampleNs || total.operations == 0) {
+      Measurement m = c.body();
+      total.nanoseconds += m.nanoseconds;
+      total.operations += m.operations;
+    }
+    return double(total.nanoseconds) / double(total.operations);
+  }
+
+  QVector<BenchmarkCase> m_cases;
+  QString m_filter;
+  int m_runs = 10;
+  qint64 m_minSampleNs = 50 * 1000000;
+};
+
+#endif  // BENCHMARK_HPP
@@ -0,0 +1,230 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "benchmark.hpp"
+#include "board.hpp"
+#include "ordering.hpp"
+#include "scaling.hpp"
+#include "tilemodel.hpp"
+
+/**
+ * @file main.cpp
+ * @brief Benchmarks for the Board and TileModel operations.
+ *
+ * Usage:
+ *   bench [--runs N] [--min-time ms] [--filter text]
+ *         [--save baseline.json] [--compare baseline.json] [--threshold pct]
+ *   bench --scaling [--sizes 144,1000,10000,100000] [--layers 8]
+ *         [--moves 20] [--csv scaling.csv]
+ *   bench --ordering [--seeds hardseeds.txt] [--node-limit N]
+ *         [--csv ordering.csv]
+ *
+ * With --save the results are written as a JSON baseline. With --compare
+ * the run is checked against a previously saved baseline and the process
+ * exits with status 1 if any benchmark became significantly slower.
+ *
+ * With --scaling, synthetic layouts of the given sizes are dealt and played
+ * instead, and the cost per deal and per move is printed as CSV.
+ *
+ * With --ordering, the solver's move ordering heuristics are compared on
+ * a corpus of hard deals instead (see ordering.hpp).
+ */
+
+namespace {
+
+bool sameFace(Tile* a, Tile* b) {
+  return a->type() == b->type() && a->value() == b->value();
+}
+
+// Returns two open tiles that either match or (if wantMatch is false) do
+// not match. Lookup cost is not part of any measurement.
+QPair<Tile*, Tile*> findOpenPair(const TileModel& model, bool wantMatch) {
+  QList<Tile*> all = model.allTiles();
+  for (int i = 0; i < all.size(); ++i) {
+    if (!all[i]->open()) continue;
+    for (int j = i + 1; j < all.size(); ++j) {
+      if (!all[j]->open()) continue;
+      if (sameFace(all[i], all[j]) == wantMatch) return {all[i], all[j]};
+    }
+  }
+  return {nullptr, nullptr};
+}
+
+void addBoardBenchmarks(BenchmarkRunner& runner, TileModel& model,
+                        Board& board) {
+  runner.add("Board::generateTurtleLayout", [&]() {
+    QElapsedTimer timer;
+    timer.start();
+    board.generateTurtleLayout();
+    return Measurement{timer.nsecsElapsed(), 1};
+  });
+
+  runner.add("Board::shuffle", [&]() {
+    board.generateTurtleLayout();
+    QElapsedTimer timer;
+    timer.start();
+    board.shuffle();
+    return Measurement{timer.nsecsElapsed(), 1};
+  });
+
+  // Plays a whole game of matching moves, timing only the two clicks.
+  runner.add("Board::selectTile (match)", [&]() {
+    board.generateTurtleLayout();
+    Measurement m;
+    for (;;) {
+      auto [a, b] = findOpenPair(model, true);
+      if (!a) break;
+      int r1 = a->row(), c1 = a->column();
+      int r2 = b->row(), c2 = b->column();
+      QElapsedTimer timer;
+      timer.start();
+      board.selectTile(r1, c1);
+      board.selectTile(r2, c2);
+      m.nanoseconds += timer.nsecsElapsed();
+      ++m.operations;
+    }
+    return m;
+  });
+
+  runner.add("Board::selectTile (mismatch)", [&]() {
+    board.generateTurtleLayout();
+    auto [a, b] = findOpenPair(model, false);
+    if (!a) return Measurement{0, 0};
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 100; ++i) {
+      board.selectTile(a->row(), a->column());
+      board.selectTile(b->row(), b->column());
+    }
+    return Measurement{timer.nsecsElapsed(), 100};
+  });
+
+  runner.add("TileModel::findTileByPosition", [&]() {
+    board.generateTurtleLayout();
+    QElapsedTimer timer;
+    timer.start();
+    qint64 ops = 0;
+    for (int r = 0; r < 12; ++r) {
+      for (int c = 0; c < 14; ++c) {
+        model.findTileByPosition(r, c);
+        ++ops;
+      }
+    }
+    return Measurement{timer.nsecsElapsed(), ops};
+  });
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("bench");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Board and TileModel benchmarks");
+  parser.addHelpOption();
+  QCommandLineOption runsOpt("runs", "Samples per benchmark.", "N", "10");
+  QCommandLineOption minTimeOpt("min-time", "Minimum time per sample.", "ms",
+                                "50");
+  QCommandLineOption filterOpt("filter", "Only run matching benchmarks.",
+                               "text");
+  QCommandLineOption saveOpt("save", "Save results as a JSON baseline.",
+                             "file");
+  QCommandLineOption compareOpt("compare", "Compare against a baseline.",
+                                "file");
+  QCommandLineOption thresholdOpt(
+      "threshold", "Smallest relative change reported as significant.", "pct",
+      "3");
+  QCommandLineOption scalingOpt("scaling",
+                                "Measure cost against layout size instead.");
+  QCommandLineOption sizesOpt("sizes", "Slot counts for --scaling.", "list",
+                              "144,1000,10000,100000");
+  QCommandLineOption layersOpt("layers", "Layers for --scaling.", "N", "8");
+  QCommandLineOption movesOpt("moves", "Moves timed per size.", "N", "20");
+  QCommandLineOption csvOpt(
+      "csv", "Also write --scaling or --ordering output here.", "file");
+  QCommandLineOption orderingOpt(
+      "ordering", "Compare the solver's move orderings instead.");
+  QCommandLineOption seedsOpt("seeds", "Seed corpus for --ordering.", "file",
+                              "hardseeds.txt");
+  QCommandLineOption nodeLimitOpt("node-limit",
+                                  "Nodes per deal for --ordering.", "N",
+                                  "1000000");
+  parser.addOptions({runsOpt, minTimeOpt, filterOpt, saveOpt, compareOpt,
+                     thresholdOpt, scalingOpt, sizesOpt, layersOpt, movesOpt,
+                     csvOpt, orderingOpt, seedsOpt, nodeLimitOpt});
+  parser.process(app);
+
+  QTextStream out(stdout);
+
+  if (parser.isSet(scalingOpt)) {
+    QVector<int> sizes;
+    for (const QString& s : parser.value(sizesOpt).split(',')) {
+      if (s.toInt() > 0) sizes.append(s.toInt());
+    }
+    runScaling(out, sizes, parser.value(layersOpt).toInt(),
+               parser.value(movesOpt).toInt(), parser.value(csvOpt));
+    return 0;
+  }
+
+  if (parser.isSet(orderingOpt)) {
+    QVector<quint64> seeds;
+    QString error;
+    if (!loadSeeds(parser.value(seedsOpt), &seeds, &error)) {
+      out << error << Qt::endl;
+      return 2;
+    }
+    runOrdering(out, seeds, parser.value(nodeLimitOpt).toLongLong(),
+                parser.value(csvOpt));
+    return 0;
+  }
+
+  BenchmarkRunner runner;
+  runner.setRuns(parser.value(runsOpt).toInt());
+  runner.setMinSampleTime(parser.value(minTimeOpt).toLongLong());
+  runner.setFilter(parser.value(filterOpt));
+
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  addBoardBenchmarks(runner, model, board);
+
+  // Load the baseline first so that a bad path fails before the run.
+  QMap<QString, BenchmarkResult> baseline;
+  if (parser.isSet(compareOpt)) {
+    QString host;
+    if (!BenchmarkRunner::loadBaseline(parser.value(compareOpt), baseline,
+                                       &host)) {
+      out << "Cannot read baseline " << parser.value(compareOpt) << Qt::endl;
+      return 2;
+    }
+    if (host != QSysInfo::machineHostName()) {
+      out << "Warning: baseline was recorded on " << host
+          << ", timings may not be comparable." << Qt::endl;
+    }
+  }
+
+  QVector<BenchmarkResult> results = runner.run(out);
+
+  if (parser.isSet(saveOpt)) {
+    if (!BenchmarkRunner::saveBaseline(parser.value(saveOpt), results)) {
+      out << "Cannot write baseline " << parser.value(saveOpt) << Qt::endl;
+      return 2;
+    }
+    out << "Baseline saved to " << parser.value(saveOpt) << Qt::endl;
+  }
+
+  if (parser.isSet(compareOpt)) {
+    double threshold = parser.value(thresholdOpt).toDouble() / 100.0;
+    int slowdowns =
+        BenchmarkRunner::compare(out, baseline, results, threshold);
+    if (slowdowns > 0) {
+      out << slowdowns << " benchmark(s) significantly slower." << Qt::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+#ifndef ORDERING_HPP
+#define ORDERING_HPP
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include "boardstate.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+#include "solver.hpp"
+
+/**
+ * @file ordering.hpp
+ * @brief Measures the solver's move ordering heuristics on hard deals.
+ *
+ * Every combination of Solver::Ordering flags solves the same list of
+ * turtle seeds (by default bench/hardseeds.txt, deals the solver without
+ * ordering needs many nodes for or gives up on) with the same node limit.
+ * For each combination the deals solved, proven unsolvable and given up
+ * on, the nodes searched and the time are printed as CSV. All deals run
+ * on one thread so that the times are comparable.
+ */
+
+struct OrderingPoint {
+  unsigned ordering = 0;
+  int solvable = 0;
+  int unsolvable = 0;
+  int unknown = 0;
+  qint64 nodes = 0;
+  double ms = 0.0;
+};
+
+// Reads one seed per line; text after '#' is a comment.
+inline bool loadSeeds(const QString& path, QVector<quint64>* seeds,
+                      QString* error) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    *error = "Cannot read " + path;
+    return false;
+  }
+  int line = 0;
+  while (!file.atEnd()) {
+    ++line;
+    const QString text =
+        QString::fromUtf8(file.readLine()).section('#', 0, 0).trimmed();
+    if (text.isEmpty()) continue;
+    bool ok = false;
+    seeds->append(text.toULongLong(&ok));
+    if (!ok) {
+      *error = QString("%1:%2: not a seed").arg(path).arg(line);
+      return false;
+    }
+  }
+  return true;
+}
+
+inline QString orderingName(unsigned ordering) {
+  QStringList names;
+  if (ordering & Solver::LastPair) names << "last-pair";
+  if (ordering & Solver::FreesTiles) names << "frees-tiles";
+  if (ordering & Solver::LongRows) names << "long-rows";
+  return names.isEmpty() ? QString("none") : names.join('+');
+}
+
+inline OrderingPoint measureOrdering(const QVector<quint64>& seeds,
+                                     unsigned ordering, qint64 nodeLimit) {
+  OrderingPoint p;
+  p.ordering = ordering;
+  Solver::Options options;
+  options.nodeLimit = nodeLimit;
+  options.ordering = ordering;
+  Solver solver(options);
+  const Layout turtle = Layout::turtle();
+
+  QElapsedTimer timer;
+  timer.start();
+  for (quint64 seed : seeds) {
+    BoardState state(turtle);
+    Rng rng(seed);
+    state.deal(rng);
+    const Solver::Result result = solver.solve(state);
+    p.nodes += result.nodes;
+    switch (result.status) {
+      case Solver::Status::Solvable:
+        p.solvable++;
+        break;
+      case Solver::Status::Unsolvable:
+        p.unsolvable++;
+        break;
+      case Solver::Status::Unknown:
+        p.unknown++;
+        break;
+    }
+  }
+  p.ms = timer.nsecsElapsed() / 1e6;
+  return p;
+}
+
+inline void runOrdering(QTextStream& out, const QVector<quint64>& seeds,
+                        qint64 nodeLimit, const QString& csvPath) {
+  QFile csv(csvPath);
+  QTextStream csvOut(&csv);
+  bool writeCsv = !csvPath.isEmpty() &&
+                  csv.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+  const QString header = "ordering,solvable,unsolvable,unknown,nodes,ms";
+  out << header << Qt::endl;
+  if (writeCsv) csvOut << header << Qt::endl;
+
+  const unsigned all =
+      Solver::LastPair | Solver::FreesTiles | Solver::LongRows;
+  for (unsigned ordering = 0; ordering <= all; ++ordering) {
+    OrderingPoint p = measureOrdering(seeds, ordering, nodeLimit);
+    QString line = QString("%1,%2,%3,%4,%5,%6")
+                       .arg(orderingName(p.ordering))
+                       .arg(p.solvable)
+                       .arg(p.unsolvable)
+                       .arg(p.unknown)
+                       .arg(p.nodes)
+                       .arg(p.ms, 0, 'f', 1);
+    out << line << Qt::endl;
+    if (writeCsv) csvOut << line << Qt::endl;
+  }
+}
+
+#endif  // ORDERING_HPP
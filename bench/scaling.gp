@@ -0,0 +1,14 @@
+# Plots the output of `bench --scaling --csv scaling.csv`:
+#   gnuplot -e "csv='scaling.csv'" scaling.gp
+if (!exists("csv")) csv = 'scaling.csv'
+set datafile separator ','
+set terminal pngcairo size 900,600
+set output 'scaling.png'
+set logscale xy
+set key top left
+set grid
+set xlabel 'slots'
+set ylabel 'cost'
+plot csv using 1:3 skip 1 with linespoints title 'generate (ms)', \
+     csv using 1:4 skip 1 with linespoints title 'move (us)', \
+     csv using 1:5 skip 1 with linespoints title 'shuffle (ms)'
@@ -0,0 +1,106 @@
+#ifndef SCALING_HPP
+#define SCALING_HPP
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+#include <QVector>
+
+#include "board.hpp"
+#include "layout.hpp"
+#include "tilemodel.hpp"
+
+/**
+ * @file scaling.hpp
+ * @brief Measures how Board operations scale with the number of slots.
+ *
+ * Synthetic layouts of increasing size are generated with Layout::synthetic
+ * and for each size the cost of dealing a game and of a matching move is
+ * measured. The result is printed as CSV so it can be plotted, for example
+ * with bench/scaling.gp.
+ */
+
+struct ScalingPoint {
+  int slots = 0;
+  int layers = 0;
+  double generateMs = 0.0;
+  double moveUs = 0.0;
+  double shuffleMs = 0.0;
+};
+
+// Returns two open tiles with the same face, or a pair of nullptrs.
+inline QPair<Tile*, Tile*> findOpenMatch(const TileModel& model) {
+  QHash<QPair<QString, int>, Tile*> seen;
+  for (int i = 0; i < model.rowCount(); ++i) {
+    Tile* t = model.tileAt(i);
+    if (!t->open()) continue;
+    auto key = qMakePair(t->type(), t->value());
+    auto it = seen.constFind(key);
+    if (it != seen.constEnd()) return {it.value(), t};
+    seen.insert(key, t);
+  }
+  return {nullptr, nullptr};
+}
+
+inline ScalingPoint measureScaling(Board& board, TileModel& model,
+                                   int slots, int layers, int moves) {
+  ScalingPoint p;
+  Layout layout = Layout::synthetic(slots, layers);
+  p.slots = layout.size();
+  p.layers = layout.layerCount();
+
+  QElapsedTimer timer;
+  timer.start();
+  board.generateLayout(layout);
+  p.generateMs = timer.nsecsElapsed() / 1e6;
+
+  qint64 moveNs = 0;
+  int played = 0;
+  for (; played < moves; ++played) {
+    auto [a, b] = findOpenMatch(model);
+    if (!a) break;
+    int r1 = a->row(), c1 = a->column();
+    int r2 = b->row(), c2 = b->column();
+    timer.restart();
+    board.selectTile(r1, c1);
+    board.selectTile(r2, c2);
+    moveNs += timer.nsecsElapsed();
+  }
+  p.moveUs = played ? moveNs / 1e3 / played : 0.0;
+
+  timer.restart();
+  board.shuffle();
+  p.shuffleMs = timer.nsecsElapsed() / 1e6;
+  return p;
+}
+
+inline void runScaling(QTextStream& out, const QVector<int>& sizes,
+                       int layers, int moves, const QString& csvPath) {
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+
+  QFile csv(csvPath);
+  QTextStream csvOut(&csv);
+  bool writeCsv = !csvPath.isEmpty() &&
+                  csv.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+  const QString header = "slots,layers,generate_ms,move_us,shuffle_ms";
+  out << header << Qt::endl;
+  if (writeCsv) csvOut << header << Qt::endl;
+
+  for (int size : sizes) {
+    ScalingPoint p = measureScaling(board, model, size, layers, moves);
+    QString line = QString("%1,%2,%3,%4,%5")
+                       .arg(p.slots)
+                       .arg(p.layers)
+                       .arg(p.generateMs, 0, 'f', 3)
+                       .arg(p.moveUs, 0, 'f', 3)
+                       .arg(p.shuffleMs, 0, 'f', 3);
+    out << line << Qt::endl;
+    if (writeCsv) csvOut << line << Qt::endl;
+  }
+}
+
+#endif  // SCALING_HPP
@@ -0,0 +1,125 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @file stats.hpp
+ * @brief Summary statistics used by the benchmark runner.
+ *
+ * Each benchmark is measured as a set of independent samples (ns per
+ * operation). This file computes the mean, standard deviation and a 95%
+ * confidence interval for such a set, and compares two sets with Welch's
+ * t-interval so that a slowdown is only reported when it is larger than
+ * the run-to-run noise on the machine.
+ */
+
+namespace Stats {
+
+struct Summary {
+  int count = 0;
+  double mean = 0.0;
+  double stddev = 0.0;
+  double min = 0.0;
+  double median = 0.0;
+  double ciLow = 0.0;   // 95% confidence interval of the mean
+  double ciHigh = 0.0;
+};
+
+// Two-sided 97.5% quantile of Student's t distribution.
+inline double tQuantile975(double df) {
+  static const double table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df < 1.0) df = 1.0;
+  if (df <= 30.0) {
+    // Interpolate between integer degrees of freedom (Welch's df is real).
+    int lo = static_cast<int>(std::floor(df));
+    int hi = std::min(lo + 1, 30);
+    double frac = df - lo;
+    return table[lo - 1] + (table[hi - 1] - table[lo - 1]) * frac;
+  }
+  // Cornish-Fisher expansion around the normal quantile.
+  const double z = 1.959964;
+  return z + (z * z * z + z) / (4.0 * df);
+}
+
+inline Summary summarize(std::vector<double> samples) {
+  Summary s;
+  s.count = static_cast<int>(samples.size());
+  if (samples.empty()) return s;
+
+  std::sort(samples.begin(), samples.end());
+  s.min = samples.front();
+  size_t mid = samples.size() / 2;
+  s.median = samples.size() % 2
+                 ? samples[mid]
+                 : (samples[mid - 1] + samples[mid]) / 2.0;
+
+  double sum = 0.0;
+  for (double v : samples) sum += v;
+  s.mean = sum / s.count;
+
+  if (s.count > 1) {
+    double sq = 0.0;
+    for (double v : samples) sq += (v - s.mean) * (v - s.mean);
+    s.stddev = std::sqrt(sq / (s.count - 1));
+    double half = tQuantile975(s.count - 1) * s.stddev / std::sqrt(s.count);
+    s.ciLow = s.mean - half;
+    s.ciHigh = s.mean + half;
+  } else {
+    s.ciLow = s.ciHigh = s.mean;
+  }
+  return s;
+}
+
+struct Comparison {
+  double ratio = 1.0;     // current mean / baseline mean
+  double diffLow = 0.0;   // 95% interval of (current - baseline)
+  double diffHigh = 0.0;
+  bool slower = false;    // statistically significant slowdown
+  bool faster = false;    // statistically significant speedup
+};
+
+/**
+ * Welch's two-sample interval for the difference of means. A change is
+ * significant only when the whole interval lies on one side of zero and
+ * the relative change exceeds @p minRelative, so that tiny but very stable
+ * differences are not reported as regressions.
+ */
+inline Comparison compare(const Summary& baseline, const Summary& current,
+                          double minRelative) {
+  Comparison c;
+  if (baseline.count == 0 || current.count == 0 || baseline.mean <= 0.0)
+    return c;
+
+  c.ratio = current.mean / baseline.mean;
+  double diff = current.mean - baseline.mean;
+
+  double vb = baseline.stddev * baseline.stddev / baseline.count;
+  double vc = current.stddev * current.stddev / current.count;
+  double se = std::sqrt(vb + vc);
+
+  double df = 1.0;
+  if (se > 0.0 && baseline.count > 1 && current.count > 1) {
+    double num = (vb + vc) * (vb + vc);
+    double den = vb * vb / (baseline.count - 1) + vc * vc / (current.count - 1);
+    df = den > 0.0 ? num / den : baseline.count + current.count - 2;
+  }
+
+  double half = tQuantile975(df) * se;
+  c.diffLow = diff - half;
+  c.diffHigh = diff + half;
+
+  double relative = std::abs(c.ratio - 1.0);
+  c.slower = c.diffLow > 0.0 && relative >= minRelative;
+  c.faster = c.diffHigh < 0.0 && relative >= minRelative;
+  return c;
+}
+
+}  // namespace Stats
+
+#endif  // STATS_HPP
@@ -10,7 +10,27 @@ SOURCES += \
 
 HEADERS += \
     src/tile.hpp \
+    src/dealdatabase.hpp \
     src/tilemodel.hpp \
+    src/undohistory.hpp \
+    src/tilekind.hpp \
+    src/layout.hpp \
+    src/layoutloader.hpp \
+    src/memoryreport.hpp \
+    src/replayarchive.hpp \
+    src/replaylog.hpp \
+    src/rng.hpp \
+    src/beamsolver.hpp \
+    src/boardsnapshot.hpp \
+    src/boardstate.hpp \
+    src/savegame.hpp \
+    src/solutioncache.hpp \
+    src/solver.hpp \
+    src/solverservice.hpp \
+    src/startup.hpp \
+    src/telemetry.hpp \
+    src/transpositiontable.hpp \
+    src/winestimator.hpp \
     src/board.hpp
 
 
@@ -22,5 +42,5 @@ QML_FILES += \
 
 DISTFILES += src/qml/main.qml
 
-QT += multimedia
+QT += multimedia network
 
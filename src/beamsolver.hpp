@@ -0,0 +1,315 @@
+#ifndef BEAMSOLVER_HPP
+#define BEAMSOLVER_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+#include "solver.hpp"
+#include "tilekind.hpp"
+
+/**
+ * @file beamsolver.hpp
+ * @brief Best-effort solver with bounded time and memory.
+ *
+ * Beam search over the same move generator as Solver and Board
+ * (Moves::append). Level d of the search holds the positions after d
+ * pairs; of all positions one pair further only the beamWidth best-scored
+ * survive. A position scores by
+ *
+ *   openPairWeight * (pairs removable in it)
+ *     + freedWeight * (tiles its last move opened)
+ *
+ * and dead positions (no pairs left) are dropped. Both terms are computed
+ * from the parent incrementally: only the slots next to and below the
+ * removed pair can change.
+ *
+ * Solvable answers come with a playable solution. A failed search proves
+ * nothing unless no level ever had to be cut to the beam width, in which
+ * case it was exhaustive and the deal is reported unsolvable; otherwise the
+ * status is Unknown, as it is when the time budget runs out.
+ */
+
+class BeamSolver {
+ public:
+  struct Options {
+    int beamWidth = 256;
+    int64_t memoryBudget = int64_t(32) << 20;  // Bytes; narrows the beam
+    int64_t timeBudgetMs = 250;  // 0: no limit
+    int openPairWeight = 4;
+    int freedWeight = 1;
+  };
+
+  BeamSolver() = default;
+  explicit BeamSolver(const Options& options) : m_options(options) {}
+
+  // Nodes are positions expanded; the solution is empty unless Solvable.
+  Solver::Result solve(const BoardState& state) {
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline =
+        Clock::now() + std::chrono::milliseconds(m_options.timeBudgetMs);
+
+    m_layout = &state.layout();
+    m_kinds = &state.kinds();
+    m_words = (state.size() + 63) / 64;
+    m_zobrist.resize(size_t(state.size()));
+    Rng rng(0x5a0b7157);
+    for (uint64_t& z : m_zobrist) z = rng();
+
+    Solver::Result result;
+    if (state.isCleared()) {
+      result.status = Solver::Status::Solvable;
+      return result;
+    }
+
+    const int levels = state.remaining() / 2;
+    const int width = beamWidth(state);
+    std::vector<uint64_t> beam(size_t(m_words), 0);
+    std::vector<uint64_t> hashes(1, 0);
+    for (int s = 0; s < state.size(); ++s) {
+      if (state.occupied(s)) {
+        beam[s / 64] |= bit(s);
+        hashes[0] ^= m_zobrist[s];
+      }
+    }
+    m_steps.assign(size_t(levels), {});
+
+    m_class.resize(size_t(state.size()));
+    for (int s = 0; s < state.size(); ++s)
+      m_class[s] = uint8_t(TileKind::matchClass(state.kind(s)));
+
+    bool pruned = false;
+    std::vector<Candidate> candidates;
+    for (int level = 0; level < levels; ++level) {
+      const int remaining = state.remaining() - 2 * level;
+      const int nodes = int(hashes.size());
+      candidates.clear();
+      clearSeen(size_t(nodes) * ExpectedBranching);
+      for (int n = 0; n < nodes; ++n) {
+        if (m_options.timeBudgetMs > 0 && Clock::now() > deadline) {
+          result.nodes += n;
+          return result;
+        }
+        const uint64_t* bits = &beam[size_t(n) * m_words];
+        Candidate last;
+        if (expand(bits, hashes[n], n, remaining, &candidates, &last)) {
+          result.nodes += n + 1;
+          m_steps[level].push_back({n, last.move});
+          result.status = Solver::Status::Solvable;
+          result.solution = solution(level, int(m_steps[level].size()) - 1);
+          return result;
+        }
+      }
+      result.nodes += nodes;
+      if (candidates.empty()) break;
+
+      if (int(candidates.size()) > width) {
+        pruned = true;
+        std::nth_element(candidates.begin(), candidates.begin() + width,
+                         candidates.end(),
+                         [](const Candidate& a, const Candidate& b) {
+                           return a.score > b.score;
+                         });
+        candidates.resize(size_t(width));
+      }
+
+      std::vector<uint64_t> next(candidates.size() * size_t(m_words));
+      hashes.resize(candidates.size());
+      for (size_t i = 0; i < candidates.size(); ++i) {
+        const Candidate& c = candidates[i];
+        std::copy_n(&beam[size_t(c.parent) * m_words], m_words,
+                    &next[i * m_words]);
+        next[i * m_words + c.move.first / 64] &= ~bit(c.move.first);
+        next[i * m_words + c.move.second / 64] &= ~bit(c.move.second);
+        hashes[i] = c.hash;
+        m_steps[level].push_back({c.parent, c.move});
+      }
+      beam.swap(next);
+    }
+
+    if (!pruned) result.status = Solver::Status::Unsolvable;
+    return result;
+  }
+
+  // The beam width solve() uses for a position: Options::beamWidth, or
+  // less if that many nodes would not fit the memory budget.
+  int beamWidth(const BoardState& state) const {
+    const int64_t words = (state.size() + 63) / 64;
+    const int64_t perNode = int64_t(sizeof(Step)) * (state.remaining() / 2) +
+                            2 * words * int64_t(sizeof(uint64_t)) +
+                            ExpectedBranching * int64_t(sizeof(Candidate));
+    return int(std::max<int64_t>(
+        1, std::min<int64_t>(m_options.beamWidth,
+                             m_options.memoryBudget / perNode)));
+  }
+
+ private:
+  // Candidates per node assumed by the memory estimate.
+  static constexpr int ExpectedBranching = 8;
+
+  struct Candidate {
+    int64_t score;
+    uint64_t hash;
+    int32_t parent;
+    Move move;
+  };
+
+  // How a position of one level came from a position of the level before.
+  struct Step {
+    int32_t parent;
+    Move move;
+  };
+
+  // A position of the beam, for the shared move generator.
+  struct Position {
+    const BeamSolver* solver;
+    const uint64_t* bits;
+
+    int size() const { return int(solver->m_kinds->size()); }
+    bool occupied(int s) const { return bits[s / 64] & bit(s); }
+    int kind(int s) const { return (*solver->m_kinds)[s]; }
+    bool isOpen(int s) const {
+      return solver->m_layout->isOpen(s, [this](int o) { return occupied(o); });
+    }
+  };
+
+  static uint64_t bit(int slot) { return uint64_t(1) << (slot % 64); }
+
+  static int64_t pairCount(const std::array<int, TileKind::Count>& open) {
+    int64_t pairs = 0;
+    for (int n : open) pairs += int64_t(n) * (n - 1) / 2;
+    return pairs;
+  }
+
+  /**
+   * Adds the live children of a position to the candidates, skipping
+   * positions already reached on this level. Returns true, with the move
+   * in *last, if a child clears the board.
+   */
+  bool expand(const uint64_t* bits, uint64_t hash, int parent, int remaining,
+              std::vector<Candidate>* candidates, Candidate* last) {
+    const Position p = {this, bits};
+    m_open.clear();
+    Moves::appendOpenSlots(p, &m_open);
+    m_wasOpen.assign(m_kinds->size(), false);
+    std::array<int, TileKind::Count> openPerClass = {};
+    for (int32_t s : m_open) {
+      m_wasOpen[s] = true;
+      openPerClass[m_class[s]]++;
+    }
+    const int64_t parentPairs = pairCount(openPerClass);
+
+    m_moves.clear();
+    Moves::append(p, &m_moves);
+    m_child.resize(size_t(m_words));
+    for (const Move& m : m_moves) {
+      if (remaining == 2) {
+        last->move = m;
+        return true;
+      }
+      const uint64_t childHash =
+          hash ^ m_zobrist[m.first] ^ m_zobrist[m.second];
+      if (!insertSeen(childHash)) continue;
+
+      std::copy_n(bits, m_words, m_child.data());
+      m_child[m.first / 64] &= ~bit(m.first);
+      m_child[m.second / 64] &= ~bit(m.second);
+      const Position child = {this, m_child.data()};
+
+      // Update the pair count for the open tiles that change, then undo.
+      const int removed = m_class[m.first];
+      int64_t pairs = parentPairs - (2 * openPerClass[removed] - 3);
+      openPerClass[removed] -= 2;
+      int freed = 0;
+      auto check = [&](int s) {
+        if (!child.occupied(s) || m_wasOpen[s] || !child.isOpen(s)) return;
+        m_wasOpen[s] = true;  // Counted once if both removed tiles touch it
+        m_touched.push_back(s);
+        pairs += openPerClass[m_class[s]]++;
+        ++freed;
+      };
+      m_layout->forEachAffected(m.first, check);
+      m_layout->forEachAffected(m.second, check);
+      for (int32_t s : m_touched) {
+        m_wasOpen[s] = false;
+        openPerClass[m_class[s]]--;
+      }
+      m_touched.clear();
+      openPerClass[removed] += 2;
+
+      if (pairs == 0) continue;  // Dead: no shuffles in the search
+      candidates->push_back({m_options.openPairWeight * pairs +
+                                 int64_t(m_options.freedWeight) * freed,
+                             childHash, parent, m});
+    }
+    return false;
+  }
+
+  // Empties the set of positions seen on a level, sized for about
+  // expected insertions.
+  void clearSeen(size_t expected) {
+    size_t capacity = 64;
+    while (capacity < 2 * expected) capacity *= 2;
+    m_seen.assign(capacity, 0);
+    m_seenCount = 0;
+  }
+
+  // Open addressing on the Zobrist hash; 0 marks an empty bucket. Returns
+  // false if the hash is already in the set.
+  bool insertSeen(uint64_t hash) {
+    if (2 * (m_seenCount + 1) > m_seen.size()) {
+      std::vector<uint64_t> old;
+      old.swap(m_seen);
+      m_seen.assign(old.size() * 2, 0);
+      m_seenCount = 0;
+      for (uint64_t h : old) {
+        if (h) insertSeen(h);
+      }
+    }
+    if (hash == 0) hash = 1;  // 0 marks empty buckets
+    const size_t mask = m_seen.size() - 1;
+    for (size_t i = size_t(hash >> 32) & mask;; i = (i + 1) & mask) {
+      if (m_seen[i] == hash) return false;
+      if (m_seen[i] == 0) {
+        m_seen[i] = hash;
+        ++m_seenCount;
+        return true;
+      }
+    }
+  }
+
+  // The moves leading to node index of the given level.
+  std::vector<Move> solution(int level, int index) const {
+    std::vector<Move> moves(size_t(level) + 1);
+    for (int l = level; l >= 0; --l) {
+      const Step& step = m_steps[l][index];
+      moves[l] = step.move;
+      index = step.parent;
+    }
+    return moves;
+  }
+
+  Options m_options;
+  const Layout* m_layout = nullptr;
+  const std::vector<uint8_t>* m_kinds = nullptr;
+  int m_words = 0;
+  std::vector<uint64_t> m_zobrist;
+  std::vector<uint8_t> m_class;  // Match class per slot
+  std::vector<std::vector<Step>> m_steps;  // Per level
+
+  // Scratch space of expand()
+  std::vector<int32_t> m_open;
+  std::vector<bool> m_wasOpen;
+  std::vector<int32_t> m_touched;
+  std::vector<Move> m_moves;
+  std::vector<uint64_t> m_child;
+  std::vector<uint64_t> m_seen;
+  size_t m_seenCount = 0;
+};
+
+#endif  // BEAMSOLVER_HPP
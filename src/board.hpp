@@ -1,53 +1,67 @@
 #ifndef BOARD_HPP
 #define BOARD_HPP
 
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QObject>
+#include <QSaveFile>
 #include <QSoundEffect>
 #include <QVector>
 #include <algorithm>
-#include <random>
-
+#include <array>
+
+#include "boardsnapshot.hpp"
+#include "boardstate.hpp"
+#include "dealdatabase.hpp"
+#include "layout.hpp"
+#include "layoutloader.hpp"
+#include "memoryreport.hpp"
+#include "replaylog.hpp"
+#include "rng.hpp"
+#include "savegame.hpp"
+#include "telemetry.hpp"
+#include "tilekind.hpp"
 #include "tilemodel.hpp"
+#include "undohistory.hpp"
+#include "winestimator.hpp"
 
 class Board : public QObject {
   Q_OBJECT
+  Q_PROPERTY(quint64 seed READ seed NOTIFY seedChanged)
+  Q_PROPERTY(bool canUndo READ canUndo NOTIFY historyChanged)
+  Q_PROPERTY(bool canRedo READ canRedo NOTIFY historyChanged)
+  Q_PROPERTY(double winProbability READ winProbability NOTIFY
+                 winProbabilityChanged)
+  Q_PROPERTY(double winProbabilityLow READ winProbabilityLow NOTIFY
+                 winProbabilityChanged)
+  Q_PROPERTY(double winProbabilityHigh READ winProbabilityHigh NOTIFY
+                 winProbabilityChanged)
+  Q_PROPERTY(qint64 winPlayouts READ winPlayouts NOTIFY winProbabilityChanged)
+  Q_PROPERTY(int availablePairs READ availablePairs NOTIFY
+                 availablePairsChanged)
+  Q_PROPERTY(bool solvableShuffles READ solvableShuffles WRITE
+                 setSolvableShuffles NOTIFY solvableShufflesChanged)
  public:
   explicit Board(TileModel* model, QObject* parent = nullptr)
       : QObject(parent),
         m_model(model),
         m_firstSelected(nullptr),
-        // Predefined coordinates for the turtle layout
-        layer0({{3, 3},   {3, 4},  {3, 5},  {3, 6},  {3, 7},  {3, 8},  {3, 9},
-                {3, 10},  {3, 11}, {4, 3},  {4, 4},  {4, 5},  {4, 6},  {4, 7},
-                {4, 8},   {4, 9},  {4, 10}, {4, 11}, {5, 3},  {5, 4},  {5, 5},
-                {5, 6},   {5, 7},  {5, 8},  {5, 9},  {5, 10}, {5, 11}, {6, 3},
-                {6, 4},   {6, 5},  {6, 6},  {6, 7},  {6, 8},  {6, 9},  {6, 10},
-                {6, 11},  {7, 3},  {7, 4},  {7, 5},  {7, 6},  {7, 7},  {7, 8},
-                {7, 9},   {7, 10}, {7, 11}, {8, 3},  {8, 4},  {8, 5},  {8, 6},
-                {8, 7},   {8, 8},  {8, 9},  {8, 10}, {8, 11}, {9, 3},  {9, 4},
-                {9, 5},   {9, 6},  {9, 7},  {9, 8},  {9, 9},  {9, 10}, {9, 11},
-                {10, 3},  {10, 4}, {10, 5}, {10, 6}, {10, 7}, {10, 8}, {10, 9},
-                {10, 10}, {10, 11}}),
-        layer1({{4, 4}, {4, 5}, {4, 6}, {4, 7}, {4, 8}, {4, 9}, {4, 10},
-                {5, 4}, {5, 5}, {5, 6}, {5, 7}, {5, 8}, {5, 9}, {5, 10},
-                {6, 4}, {6, 5}, {6, 6}, {6, 7}, {6, 8}, {6, 9}, {6, 10},
-                {7, 4}, {7, 5}, {7, 6}, {7, 7}, {7, 8}, {7, 9}, {7, 10},
-                {8, 4}, {8, 5}, {8, 6}, {8, 7}, {8, 8}, {8, 9}, {8, 10},
-                {9, 4}, {9, 5}, {9, 6}, {9, 7}, {9, 8}, {9, 9}, {9, 10}}),
-        layer2({{5, 5}, {5, 6}, {5, 7}, {5, 8}, {5, 9}, {6, 5}, {6, 6},
-                {6, 7}, {6, 8}, {6, 9}, {7, 5}, {7, 6}, {7, 7}, {7, 8},
-                {7, 9}, {8, 5}, {8, 6}, {8, 7}, {8, 8}, {8, 9}}),
-        layer3({{6, 6},
-                {6, 7},
-                {6, 8},
-                {7, 6},
-                {7, 7},
-                {7, 8},
-                {8, 6},
-                {8, 7},
-                {8, 8}}),
-        layer4({{7, 7}}) {
-    // Initialize sound effects
+        m_rng(Rng::randomSeed()) {}
+
+  // Headless tools (benchmarks, simulations) turn sounds off so that
+  // playback does not distort timings.
+  bool soundsEnabled() const { return m_soundsEnabled; }
+  void setSoundsEnabled(bool enabled) { m_soundsEnabled = enabled; }
+
+  /**
+   * Starts decoding the sound effects; QSoundEffect does this in the
+   * background. Called on the first sound otherwise, so boards with sounds
+   * turned off never load them. The game calls it early at startup.
+   */
+  void loadSounds() {
+    if (m_soundsLoaded) return;
+    m_soundsLoaded = true;
     m_clickSound.setSource(QUrl("qrc:/sounds/click.wav"));
     m_clickSound.setVolume(0.8);
 
@@ -58,127 +72,248 @@ class Board : public QObject {
     m_mistakeSound.setVolume(0.8);
   }
 
-  Q_INVOKABLE void generateTurtleLayout() {
-    m_model->clear();
-
-    // Combine all positions from all layers into one vector
-    QVector<QPair<int, int>> allPositions;
-    allPositions += layer0;
-    allPositions += layer1;
-    allPositions += layer2;
-    allPositions += layer3;
-    allPositions += layer4;
-
-    struct TileDefinition {
-      QString type;
-      int minVal;
-      int maxVal;
-    };
-
-    QVector<TileDefinition> standardSets = {
-        {"Bamboo", 1, 9}, {"Circle", 1, 9}, {"Pinyin", 1, 15}};
-
-    QStringList seasonTiles = {"Spring", "Summer", "Fall", "Winter"};
-    QStringList flowerTiles = {"Chrysanthemum", "Lotus", "Orchid", "Peony"};
-
-    int stdSetIndex = 0;
-    int stdValue = standardSets[stdSetIndex].minVal;
-    bool usingStandard = true;
-    int seasonIndex = 0;
-    int flowerIndex = 0;
-
-    // A vector to hold the final (type, value) pairs
-    QVector<QPair<QString, int>> tileSequence;
-    tileSequence.reserve(allPositions.size());
-
-    // Same logic as getNextTileTypeAndValue
-    auto getNextTileTypeAndValue = [&]() {
-      if (usingStandard) {
-        const auto& set = standardSets[stdSetIndex];
-        QString t = set.type;
-        int v = stdValue;
-        stdValue++;
-        if (stdValue > set.maxVal) {
-          stdSetIndex = (stdSetIndex + 1) % standardSets.size();
-          stdValue = standardSets[stdSetIndex].minVal;
-        }
-        usingStandard = false;
-        return qMakePair(t, v);
-      } else {
-        static bool useSeason = true;
-        QString t;
-        int v = 1;
-        if (useSeason) {
-          t = seasonTiles[seasonIndex];
-          seasonIndex = (seasonIndex + 1) % seasonTiles.size();
-        } else {
-          t = flowerTiles[flowerIndex];
-          flowerIndex = (flowerIndex + 1) % flowerTiles.size();
-        }
-        useSeason = !useSeason;
-        usingStandard = true;
-        return qMakePair(t, v);
-      }
-    };
+  // Seed of the current game. Dealing with the same seed reproduces the
+  // same game, including the order produced by later shuffle() calls.
+  quint64 seed() const { return m_seed; }
 
-    // Generate all tile type-value pairs in the original deterministic order
-    for (int i = 0; i < allPositions.size(); ++i) {
-      auto [t, v] = getNextTileTypeAndValue();
-      tileSequence.append(qMakePair(t, v));
+  /**
+   * Deals a turtle game. With a deal database for the turtle attached (see
+   * setDealDatabase()) a random pre-generated deal is used, otherwise a
+   * fresh shuffle.
+   */
+  Q_INVOKABLE void generateTurtleLayout() {
+    if (m_deals && m_deals->count() > 0 &&
+        m_deals->matches(Layout::turtle())) {
+      generateFromDeal(qint64(m_rng() % quint64(m_deals->count())));
+      return;
     }
+    generateLayout(Layout::turtle());
+  }
+  Q_INVOKABLE void generateTurtleLayout(quint64 seed) {
+    generateLayout(Layout::turtle(), seed);
+  }
 
-    // Now shuffle the entire sequence to produce a different starting order
-    // each time
-    {
-      std::random_device rd;
-      std::mt19937 g(rd());
-      std::shuffle(tileSequence.begin(), tileSequence.end(), g);
+  // Deals a fresh shuffled deck into every slot of the given layout, using
+  // a new seed drawn from the board's generator.
+  void generateLayout(const Layout& layout) { generateLayout(layout, m_rng()); }
+
+  // Loads a KMahjongg layout file (see LayoutLoader) and deals a game on it.
+  Q_INVOKABLE bool loadLayout(const QString& path) {
+    LayoutLoader loader;
+    QString error;
+    Layout layout = loader.load(path, &error);
+    if (layout.isEmpty()) {
+      qWarning() << "Cannot load layout:" << error;
+      return false;
     }
+    generateLayout(layout);
+    return true;
+  }
 
-    // Assign shuffled tiles to positions
-    // We know total count matches the positions
-    for (int i = 0; i < allPositions.size(); ++i) {
-      const auto& pos = allPositions[i];
-      const auto& tv = tileSequence[i];
-
-      // Determine layer based on index i (as before)
-      int idx = i;
-      int layer = 0;
-      int remainder = idx;
-      if (remainder >= layer0.size()) {
-        remainder -= layer0.size();
-        layer = 1;
-        if (remainder >= layer1.size()) {
-          remainder -= layer1.size();
-          layer = 2;
-          if (remainder >= layer2.size()) {
-            remainder -= layer2.size();
-            layer = 3;
-            if (remainder >= layer3.size()) {
-              remainder -= layer3.size();
-              layer = 4;
-            }
-          }
-        }
-      }
+  void generateLayout(const Layout& layout, quint64 seed) {
+    Rng rng(seed);
+    BoardState state(layout);
+    state.deal(rng);
+    startDealt(std::move(state), seed, rng);
+  }
 
-      Tile* tile = new Tile();
-      tile->setType(tv.first);
-      tile->setValue(tv.second);
-      tile->setFaceUp(true);
-      tile->setRow(pos.first);
-      tile->setColumn(pos.second);
-      tile->setLayer(layer);
-      tile->setOpen(false);
-      m_model->addTile(tile);
+  /**
+   * Starts the game generateLayout(layout, seed) would deal, dealt
+   * elsewhere (for example on a worker thread at startup, see
+   * StartupPipeline): state is the deal and rng the generator right after
+   * dealing.
+   */
+  void startDealt(BoardState state, quint64 seed, const Rng& rng) {
+    QElapsedTimer timer;
+    timer.start();
+    endGame();
+    m_seed = seed;
+    m_dealIndex = -1;
+    m_rng = rng;
+    emit seedChanged();
+
+    m_state = std::move(state);
+    clearHistory();
+    rebuildTiles(-1);
+    onPositionChanged();
+    logNewGame();
+    log(ReplayFormat::Seed, 0, seed);
+    report(TelemetryEvent::GameStart, micros(timer), m_state.size());
+    autosave();
+  }
+
+  // The kinds generateLayout() deals for a seeded generator. Tools use
+  // this to reproduce Board deals.
+  static std::vector<uint8_t> dealKinds(int slotCount, Rng& rng) {
+    return BoardState::dealKinds(slotCount, rng);
+  }
+
+  // Deals are read from the deal database instead of shuffled. The game
+  // then has the seed the deal was made from, and continues exactly like
+  // the one generateLayout() deals for that seed.
+  void setDealDatabase(const DealDatabase* deals) { m_deals = deals; }
+  const DealDatabase* dealDatabase() const { return m_deals; }
+
+  // Index of the current deal in the deal database, or -1.
+  qint64 dealIndex() const { return m_dealIndex; }
+
+  Q_INVOKABLE bool generateFromDeal(qint64 index) {
+    if (!m_deals || index < 0 || index >= m_deals->count()) return false;
+    Layout turtle = Layout::turtle();
+    if (!m_deals->matches(turtle)) return false;
+
+    Deal d = m_deals->deal(index);
+    for (int i = 0; i < turtle.size(); ++i) {
+      if (d.kinds[i] >= TileKind::Count) return false;
     }
+    QElapsedTimer timer;
+    timer.start();
+    endGame();
+
+    m_seed = m_deals->seed(index);
+    m_dealIndex = index;
+    // Leave the generator where dealing from the seed would.
+    m_rng.reseed(m_seed);
+    BoardState::dealKinds(turtle.size(), m_rng);
+    emit seedChanged();
+
+    m_state = BoardState(turtle);
+    for (int i = 0; i < turtle.size(); ++i) m_state.set(i, d.kinds[i]);
+    clearHistory();
+    rebuildTiles(-1);
+    onPositionChanged();
+    logPosition();
+    report(TelemetryEvent::GameStart, micros(timer), m_state.size());
+    autosave();
+    return true;
+  }
 
-    m_firstSelected = nullptr;
-    updateOpenStates();
+  // The engine position mirrored by the tiles in the model.
+  const BoardState& state() const { return m_state; }
+
+  // An immutable copy of the position to branch from (see BoardSnapshot).
+  BoardSnapshot snapshot() const { return BoardSnapshot(m_state); }
+
+  /**
+   * Snapshot of the game in progress (see SaveGame). Cheap enough to take
+   * after every move: the kinds are copied as they are.
+   */
+  QByteArray saveState() const {
+    SaveGame::Snapshot snapshot;
+    snapshot.layoutFingerprint = m_state.layout().fingerprint();
+    snapshot.selectedSlot = m_firstSelected ? slotOf(m_firstSelected) : -1;
+    snapshot.seed = m_seed;
+    snapshot.dealIndex = m_dealIndex;
+    snapshot.rng = m_rng.state();
+    snapshot.kinds = m_state.kinds();
+    return SaveGame::write(snapshot);
   }
 
+  /**
+   * Restores a snapshot taken by saveState() on the current layout or the
+   * turtle. The model is rebuilt with a single reset. The undo history is
+   * not part of a save. Returns false and
+   * leaves the game untouched if the snapshot does not fit either layout.
+   */
+  bool restoreState(const QByteArray& bytes) {
+    SaveGame::Snapshot snapshot;
+    if (!SaveGame::read(bytes, &snapshot)) return false;
+
+    Layout layout = m_state.layout();
+    if (layout.fingerprint() != snapshot.layoutFingerprint)
+      layout = Layout::turtle();
+    if (layout.fingerprint() != snapshot.layoutFingerprint ||
+        layout.size() != int(snapshot.kinds.size()))
+      return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    endGame();
+    m_state = BoardState(layout);
+    for (int s = 0; s < layout.size(); ++s) m_state.set(s, snapshot.kinds[s]);
+
+    int selected = snapshot.selectedSlot;
+    if (selected >= 0 &&
+        (!m_state.occupied(selected) || !m_state.isOpen(selected)))
+      selected = -1;
+
+    m_seed = snapshot.seed;
+    m_dealIndex = snapshot.dealIndex;
+    m_rng.setState(snapshot.rng);
+    emit seedChanged();
+
+    clearHistory();
+    rebuildTiles(selected);
+    onPositionChanged();
+    logPosition();
+    report(TelemetryEvent::GameStart, micros(timer), m_state.size());
+    return true;
+  }
+
+  Q_INVOKABLE bool saveGame(const QString& path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    const QByteArray bytes = saveState();
+    return file.write(bytes) == bytes.size() && file.commit();
+  }
+
+  Q_INVOKABLE bool loadGame(const QString& path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) && restoreState(file.readAll());
+  }
+
+  // When set, every selection, move and shuffle is appended to this log
+  // (see ReplayWriter). The writer must outlive the board.
+  void setReplayLog(ReplayWriter* log) { m_replay = log; }
+  ReplayWriter* replayLog() const { return m_replay; }
+
+  // When set, game starts and ends, moves with their engine time, shuffles,
+  // undos and redos are posted to this sink. The sink must outlive the
+  // board.
+  void setTelemetry(TelemetrySink* sink) { m_telemetry = sink; }
+  TelemetrySink* telemetry() const { return m_telemetry; }
+
+  /**
+   * When set, the estimator keeps winProbability up to date in the
+   * background: every change of the position restarts it. The estimator
+   * must outlive the board.
+   */
+  void setWinEstimator(WinEstimator* estimator) {
+    if (m_estimator) disconnect(m_estimator, nullptr, this, nullptr);
+    m_estimator = estimator;
+    if (m_estimator) {
+      connect(m_estimator, &WinEstimator::estimated, this,
+              [this](const WinEstimate& estimate) {
+                m_winEstimate = estimate;
+                emit winProbabilityChanged();
+              });
+      estimateWin();
+    }
+  }
+  WinEstimator* winEstimator() const { return m_estimator; }
+
+  // Share of random playouts from the current position that clear it
+  // without a shuffle, with its 95% confidence interval. All three are
+  // meaningless while winPlayouts is 0.
+  double winProbability() const { return m_winEstimate.probability(); }
+  double winProbabilityLow() const { return m_winEstimate.low(); }
+  double winProbabilityHigh() const { return m_winEstimate.high(); }
+  qint64 winPlayouts() const { return m_winEstimate.playouts; }
+
+  // When set, the game is saved to this file after every match, undo,
+  // redo, shuffle and deal. The file is written in the background (see
+  // AutosaveWriter) and may lag behind by up to AutosaveWriter::DelayMs.
+  QString autosavePath() const { return m_autosave.path(); }
+  void setAutosavePath(const QString& path) { m_autosave.open(path); }
+
+  // Waits until the last autosave is in the file.
+  void flushAutosave() { m_autosave.flush(); }
+
   Q_INVOKABLE void selectTile(int row, int column) {
-    Tile* clicked = m_model->findTileByPosition(row, column);
+    QElapsedTimer timer;
+    timer.start();
+    int slot = m_state.topmostAt(row, column);
+    Tile* clicked = slot >= 0 ? m_slotTiles[slot] : nullptr;
     if (!clicked || !clicked->open()) return;
 
     if (m_firstSelected == clicked) return;
@@ -187,126 +322,372 @@ class Board : public QObject {
       // First tile selected
       clicked->setSelected(true);
       m_firstSelected = clicked;
-      m_clickSound.play();
+      log(ReplayFormat::Select, slot);
+      playSound(m_clickSound);
     } else {
       // Second tile selected
-      if (tilesMatch(m_firstSelected, clicked)) {
+      int first = slotOf(m_firstSelected);
+      if (m_state.canRemove(first, slot)) {
         // Matching pair
-        Tile* toRemove1 = m_firstSelected;
-        Tile* toRemove2 = clicked;
         m_firstSelected = nullptr;
-        m_model->removeTile(toRemove1);
-        m_model->removeTile(toRemove2);
-        updateOpenStates();
-        m_removePairSound.play();
+        m_history.pushPair(m_state, first, slot);
+        countOpen(m_state.kind(first), -1);
+        countOpen(m_state.kind(slot), -1);
+        m_state.removePair(first, slot);
+        m_model->removeTile(m_slotTiles[first]);
+        m_model->removeTile(clicked);
+        m_slotTiles[first] = nullptr;
+        m_slotTiles[slot] = nullptr;
+        updateOpenStatesAround(first);
+        updateOpenStatesAround(slot);
+        pairsChanged();
+        log(ReplayFormat::Match, first, slot);
+        emit historyChanged();
+        onPositionChanged();
+        report(TelemetryEvent::Move, micros(timer), first, slot, true);
+        if (m_state.isCleared())
+          report(TelemetryEvent::GameEnd, micros(timer), -1, -1,
+                 TelemetryEvent::Won);
+        playSound(m_removePairSound);
+        autosave();
       } else {
         // No match - play mistake sound
         m_firstSelected->setSelected(false);
         clicked->setSelected(false);
         m_firstSelected = nullptr;
-        m_mistakeSound.play();
+        log(ReplayFormat::Mismatch, first, slot);
+        report(TelemetryEvent::Move, micros(timer), first, slot, false);
+        playSound(m_mistakeSound);
       }
     }
   }
 
-  Q_INVOKABLE void shuffle() {
-    QList<Tile*> all = m_model->takeAllTiles();
-    if (all.isEmpty()) return;
+  // Reseeds the generator first, so the resulting order only depends on
+  // the current position and the seed.
+  Q_INVOKABLE void shuffle(quint64 seed) {
+    m_rng.reseed(seed);
+    shuffleState(seed, true);
+  }
 
-    struct TilePosition {
-      int row;
-      int column;
-      int layer;
-    };
+  Q_INVOKABLE void shuffle() { shuffleState(0, false); }
 
-    QVector<TilePosition> positions;
-    positions.reserve(all.size());
+  // When set, shuffles always leave a position that can be cleared (see
+  // BoardState::solvableShuffle()). Off by default.
+  bool solvableShuffles() const { return m_solvableShuffles; }
+  void setSolvableShuffles(bool enabled) {
+    if (m_solvableShuffles == enabled) return;
+    m_solvableShuffles = enabled;
+    emit solvableShufflesChanged();
+  }
 
-    for (Tile* t : all) {
-      TilePosition pos = {t->row(), t->column(), t->layer()};
-      positions.append(pos);
+  bool canUndo() const { return m_history.canUndo(); }
+  bool canRedo() const { return m_history.canRedo(); }
+
+  /**
+   * Takes back the last match or shuffle. A pair comes back as two new
+   * tiles and only the open states around them are recomputed; a shuffle
+   * is reverted through its permutation.
+   */
+  Q_INVOKABLE bool undo() {
+    QElapsedTimer timer;
+    timer.start();
+    clearSelection();
+    const UndoHistory::Step* step = m_history.undo(m_state);
+    if (!step) return false;
+    if (step->isShuffle()) {
+      rebuildTiles(-1);
+    } else {
+      addTileAt(step->first);
+      addTileAt(step->second);
+      updateOpenStatesAround(step->first);
+      updateOpenStatesAround(step->second);
+      pairsChanged();
     }
+    log(ReplayFormat::Undo);
+    emit historyChanged();
+    onPositionChanged();
+    report(TelemetryEvent::Undo, micros(timer));
+    autosave();
+    return true;
+  }
 
-    std::vector<Tile*> tilesVector;
-    tilesVector.reserve(all.size());
-    for (Tile* t : all) {
-      tilesVector.push_back(t);
+  Q_INVOKABLE bool redo() {
+    QElapsedTimer timer;
+    timer.start();
+    clearSelection();
+    const UndoHistory::Step* step = m_history.redo(m_state);
+    if (!step) return false;
+    if (step->isShuffle()) {
+      rebuildTiles(-1);
+    } else {
+      for (int slot : {step->first, step->second}) {
+        m_model->removeTile(m_slotTiles[slot]);
+        m_slotTiles[slot] = nullptr;
+      }
+      countOpen(step->firstKind, -1);
+      countOpen(step->secondKind, -1);
+      updateOpenStatesAround(step->first);
+      updateOpenStatesAround(step->second);
+      pairsChanged();
     }
+    log(ReplayFormat::Redo);
+    emit historyChanged();
+    onPositionChanged();
+    report(TelemetryEvent::Redo, micros(timer));
+    autosave();
+    return true;
+  }
 
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(tilesVector.begin(), tilesVector.end(), g);
-
-    m_model->clear();
+  /**
+   * Number of pairs selectTile() would remove right now, the size of
+   * availableMoves(). Kept up to date per move from the open tiles that
+   * change, so reading it costs nothing; noMovesLeft is emitted when it
+   * drops to 0 with tiles left.
+   */
+  int availablePairs() const { return m_availablePairs; }
+
+  // All pairs of open tiles that selectTile() would remove right now.
+  QVector<QPair<Tile*, Tile*>> availableMoves() const {
+    std::vector<Move> pairs;
+    m_state.appendMoves(&pairs);
+
+    QVector<QPair<Tile*, Tile*>> moves;
+    moves.reserve(int(pairs.size()));
+    for (const Move& m : pairs)
+      moves.append(qMakePair(m_slotTiles[m.first], m_slotTiles[m.second]));
+    return moves;
+  }
 
-    for (int i = 0; i < positions.size(); ++i) {
-      Tile* t = tilesVector[i];
-      t->setRow(positions[i].row);
-      t->setColumn(positions[i].column);
-      t->setLayer(positions[i].layer);
-      t->setSelected(false);
-      t->setOpen(false);
-      m_model->addTile(t);
+  // Estimated memory held by each part of the game. See MemoryReport for
+  // how the numbers are obtained.
+  MemoryReport memoryReport() const {
+    MemoryReport report;
+    const QList<Tile*> tiles = m_model->allTiles();
+
+    qint64 tileBytes = 0;
+    qint64 connections = 0;
+    for (Tile* t : tiles) {
+      tileBytes += sizeof(Tile) + MemoryReport::QObjectPrivateBytes +
+                   MemoryReport::stringBytes(t->type());
+      connections += t->connectionCount();
     }
+    report.add("Tile objects", tiles.size(), tileBytes);
+
+    report.add("TileModel vector", m_model->capacity(),
+               MemoryReport::ArrayHeaderBytes +
+                   m_model->capacity() * qint64(sizeof(Tile*)));
+
+    // Each connected tile also gets connection bookkeeping with one list
+    // per signal (QObject's two plus Tile's eight).
+    report.add("Signal connections", connections,
+               connections * MemoryReport::ConnectionBytes +
+                   tiles.size() * (MemoryReport::ConnectionDataBytes +
+                                   10 * MemoryReport::ConnectionListBytes));
+
+    const Layout& layout = m_state.layout();
+    report.add("Layout tables", layout.size(),
+               qint64(sizeof(BoardState)) + qint64(layout.byteSize()) +
+                   qint64(m_state.kinds().capacity()) +
+                   m_slotTiles.capacity() * qint64(sizeof(Tile*)));
+
+    report.add("Undo history", qint64(m_history.size()),
+               qint64(sizeof(UndoHistory)) + qint64(m_history.byteSize()));
+
+    qint64 images = 0;
+    qint64 imageBytes = MemoryReport::decodedImageBytes(":/images", &images);
+    report.add("Decoded images", images, imageBytes);
+
+    qint64 sounds = 0;
+    qint64 soundBytes = MemoryReport::soundBufferBytes(":/sounds", &sounds);
+    report.add("Sound buffers", sounds, soundBytes);
+    return report;
+  }
 
-    updateOpenStates();
+  Q_INVOKABLE QString memoryReportText() const {
+    return memoryReport().toText();
   }
 
+ signals:
+  void seedChanged();
+  void historyChanged();
+  void winProbabilityChanged();
+  void solvableShufflesChanged();
+  // Any change of the position: a new game, a match, a shuffle, an undo
+  // or a redo.
+  void positionChanged();
+  void availablePairsChanged();
+  // The position has tiles left but no removable pair; only a shuffle (or
+  // an undo) helps.
+  void noMovesLeft();
+
  private:
-  void updateOpenStates() {
-    QList<Tile*> all = m_model->allTiles();
-    for (Tile* t : all) {
-      int r = t->row();
-      int c = t->column();
-      int l = t->layer();
-
-      bool covered = false;
-      for (Tile* other : all) {
-        if (other->layer() > l && other->row() == r && other->column() == c) {
-          covered = true;
-          break;
-        }
-      }
+  void shuffleState(quint64 seed, bool reseeded) {
+    if (m_state.isCleared()) return;
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<int32_t> permutation;
+    if (m_solvableShuffles)
+      m_state.solvableShuffle(m_rng, &permutation);
+    else
+      m_state.shuffle(m_rng, &permutation);
+    m_history.pushShuffle(std::move(permutation));
+    rebuildTiles(-1);
+    log(m_solvableShuffles ? ReplayFormat::SolvableShuffle
+                           : ReplayFormat::Shuffle,
+        0, seed, reseeded);
+    emit historyChanged();
+    onPositionChanged();
+    report(TelemetryEvent::Shuffle, micros(timer));
+    autosave();
+  }
 
-      if (covered) {
-        t->setOpen(false);
-        continue;
-      }
+  void clearHistory() {
+    m_history.clear();
+    emit historyChanged();
+  }
 
-      Tile* left = nullptr;
-      Tile* right = nullptr;
-      for (Tile* other : all) {
-        if (other->layer() == l && other->row() == r &&
-            other->column() == c - 1)
-          left = other;
-        if (other->layer() == l && other->row() == r &&
-            other->column() == c + 1)
-          right = other;
-      }
+  void clearSelection() {
+    if (!m_firstSelected) return;
+    m_firstSelected->setSelected(false);
+    m_firstSelected = nullptr;
+  }
+
+  // Creates the tile for an occupied slot and appends it to the model.
+  void addTileAt(int slot) {
+    Tile* tile = createTile(slot);
+    m_slotTiles[slot] = tile;
+    m_model->addTile(tile);
+    if (tile->open()) countOpen(m_state.kind(slot), 1);
+  }
+
+  Tile* createTile(int slot) const {
+    const LayoutSlot& pos = m_state.layout().slot(slot);
+    Tile* tile = new Tile();
+    tile->setType(QString::fromLatin1(TileKind::typeName(m_state.kind(slot))));
+    tile->setValue(TileKind::value(m_state.kind(slot)));
+    tile->setFaceUp(true);
+    tile->setRow(pos.row);
+    tile->setColumn(pos.column);
+    tile->setLayer(pos.layer);
+    tile->setOpen(m_state.isOpen(slot));
+    return tile;
+  }
 
-      bool isOpen = (left == nullptr || right == nullptr);
-      t->setOpen(isOpen);
+  // Mirrors m_state into new Tile objects and hands them to the model in
+  // one reset. Open states are set before the tiles reach the model, so
+  // this emits no change notification per tile.
+  void rebuildTiles(int selectedSlot) {
+    const Layout& layout = m_state.layout();
+    QVector<Tile*> tiles;
+    tiles.reserve(m_state.remaining());
+    m_slotTiles.fill(nullptr, layout.size());
+    m_openPerClass.fill(0);
+    m_availablePairs = 0;
+    for (int s = 0; s < layout.size(); ++s) {
+      if (!m_state.occupied(s)) continue;
+      Tile* tile = createTile(s);
+      tile->setSelected(s == selectedSlot);
+      m_slotTiles[s] = tile;
+      tiles.append(tile);
+      if (tile->open()) countOpen(m_state.kind(s), 1);
     }
+
+    m_firstSelected = selectedSlot >= 0 ? m_slotTiles[selectedSlot] : nullptr;
+    m_model->resetTiles(tiles);
+    pairsChanged();
+  }
+
+  void log(ReplayFormat::Type type, int a = 0, uint64_t value = 0,
+           uint8_t arg = 0) {
+    if (m_replay)
+      m_replay->append(ReplayFormat::make(type, uint32_t(a), value, arg));
+  }
+
+  void logNewGame() {
+    log(ReplayFormat::NewGame, m_state.size(), m_state.layout().fingerprint());
+  }
+
+  // Logs the current position in full, for games that did not come from a
+  // seed.
+  void logPosition() {
+    if (!m_replay) return;
+    logNewGame();
+    ReplayFormat::forEachPositionRecord(
+        m_state, m_rng.state(),
+        [this](const ReplayFormat::Record& r) { m_replay->append(r); });
+    if (m_firstSelected) log(ReplayFormat::Select, slotOf(m_firstSelected));
+  }
+
+  // Called after every change of the position, with the tiles rebuilt.
+  void onPositionChanged() {
+    emit positionChanged();
+    estimateWin();
   }
 
-  bool tilesMatch(Tile* a, Tile* b) {
-    if (!a || !b) return false;
+  // Restarts the win estimate for the current position.
+  void estimateWin() {
+    if (!m_estimator) return;
+    m_winEstimate = WinEstimate();
+    emit winProbabilityChanged();
+    m_estimator->estimate(m_state);
+  }
 
-    QString A = a->type();
-    QString B = b->type();
+  void report(TelemetryEvent::Type type, qint64 micros, int first = -1,
+              int second = -1, uint8_t flag = 0) {
+    if (m_telemetry)
+      m_telemetry->post(TelemetryEvent::make(type, m_seed, m_state.remaining(),
+                                             micros, first, second, flag));
+  }
 
-    QSet<QString> seasons = {"Spring", "Summer", "Fall", "Winter"};
-    QSet<QString> flowers = {"Chrysanthemum", "Lotus", "Orchid", "Peony"};
+  static qint64 micros(const QElapsedTimer& timer) {
+    return timer.nsecsElapsed() / 1000;
+  }
 
-    bool aIsSeason = seasons.contains(A);
-    bool bIsSeason = seasons.contains(B);
-    bool aIsFlower = flowers.contains(A);
-    bool bIsFlower = flowers.contains(B);
+  // Reports the game being replaced as abandoned unless it was won.
+  void endGame() {
+    if (m_state.size() > 0 && !m_state.isCleared())
+      report(TelemetryEvent::GameEnd, 0, -1, -1, TelemetryEvent::Abandoned);
+  }
 
-    if (aIsSeason && bIsSeason) return true;
-    if (aIsFlower && bIsFlower) return true;
+  void autosave() {
+    if (m_autosave.isOpen()) m_autosave.save(saveState());
+  }
 
-    return (A == B && a->value() == b->value());
+  void playSound(QSoundEffect& sound) {
+    if (!m_soundsEnabled) return;
+    loadSounds();
+    sound.play();
+  }
+
+  int slotOf(const Tile* t) const {
+    return m_state.layout().slotAt(t->row(), t->column(), t->layer());
+  }
+
+  // Removing a tile can only open its side neighbours and the tiles it
+  // covered, so only those are recomputed.
+  void updateOpenStatesAround(int slot) {
+    m_state.layout().forEachAffected(slot, [this](int s) {
+      Tile* tile = m_slotTiles[s];
+      if (!tile) return;
+      const bool open = m_state.isOpen(s);
+      if (open == tile->open()) return;
+      tile->setOpen(open);
+      countOpen(m_state.kind(s), open ? 1 : -1);
+    });
+  }
+
+  // A tile of the kind opened (delta 1) or closed or was removed (-1). Any
+  // two open tiles of a match class form a pair, so n open tiles of a
+  // class add n * (n - 1) / 2 pairs.
+  void countOpen(int kind, int delta) {
+    int& open = m_openPerClass[TileKind::matchClass(kind)];
+    m_availablePairs += delta > 0 ? open : -(open - 1);
+    open += delta;
+  }
+
+  void pairsChanged() {
+    emit availablePairsChanged();
+    if (m_availablePairs == 0 && !m_state.isCleared()) emit noMovesLeft();
   }
 
   TileModel* m_model;
@@ -315,12 +696,25 @@ class Board : public QObject {
   QSoundEffect m_clickSound;
   QSoundEffect m_removePairSound;
   QSoundEffect m_mistakeSound;
-
-  const QVector<QPair<int, int>> layer0;
-  const QVector<QPair<int, int>> layer1;
-  const QVector<QPair<int, int>> layer2;
-  const QVector<QPair<int, int>> layer3;
-  const QVector<QPair<int, int>> layer4;
+  bool m_soundsEnabled = true;
+  bool m_soundsLoaded = false;
+  bool m_solvableShuffles = false;
+
+  const DealDatabase* m_deals = nullptr;
+  qint64 m_dealIndex = -1;
+
+  BoardState m_state;
+  UndoHistory m_history;
+  QVector<Tile*> m_slotTiles;  // Tile in each layout slot, or nullptr
+  Rng m_rng;
+  quint64 m_seed = 0;
+  AutosaveWriter m_autosave;
+  ReplayWriter* m_replay = nullptr;
+  TelemetrySink* m_telemetry = nullptr;
+  WinEstimator* m_estimator = nullptr;
+  WinEstimate m_winEstimate;
+  std::array<int, TileKind::Count> m_openPerClass = {};  // Open tiles
+  int m_availablePairs = 0;
 };
 
 #endif  // BOARD_HPP
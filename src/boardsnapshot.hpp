@@ -0,0 +1,111 @@
+#ifndef BOARDSNAPSHOT_HPP
+#define BOARDSNAPSHOT_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+#include "tilekind.hpp"
+
+/**
+ * @file boardsnapshot.hpp
+ * @brief Immutable positions for branching off a game.
+ *
+ * A snapshot is a position that never changes: an occupancy bitset over the
+ * layout slots plus the kind of every slot. Both are held through shared
+ * pointers, so copying a snapshot (forking) is O(1) and never touches the
+ * Board or its TileModel. apply() returns a new snapshot that shares the
+ * layout and kinds with its parent and only owns a new bitset of
+ * size() / 64 words; only shuffled() copies the kinds.
+ *
+ * Hints, solvers and move previews can branch as often as they like from
+ * Board::snapshot() and keep the branches around cheaply.
+ */
+
+class BoardSnapshot {
+ public:
+  BoardSnapshot() = default;
+
+  explicit BoardSnapshot(const BoardState& state)
+      : m_layout(std::make_shared<const Layout>(state.layout())),
+        m_kinds(std::make_shared<const std::vector<uint8_t>>(state.kinds())),
+        m_remaining(state.remaining()) {
+    auto bits = std::make_shared<std::vector<uint64_t>>(wordCount(size()));
+    for (int s = 0; s < size(); ++s) {
+      if (state.occupied(s)) (*bits)[s / 64] |= bit(s);
+    }
+    m_bits = std::move(bits);
+  }
+
+  const Layout& layout() const { return *m_layout; }
+  int size() const { return m_kinds ? int(m_kinds->size()) : 0; }
+  int remaining() const { return m_remaining; }
+  bool isCleared() const { return m_remaining == 0; }
+
+  bool occupied(int slot) const { return (*m_bits)[slot / 64] & bit(slot); }
+
+  // Kind of a slot, or TileKind::None once its tile is removed.
+  int kind(int slot) const {
+    return occupied(slot) ? (*m_kinds)[slot] : int(TileKind::None);
+  }
+
+  bool isOpen(int slot) const {
+    return m_layout->isOpen(slot, [this](int s) { return occupied(s); });
+  }
+
+  bool canRemove(int a, int b) const {
+    return a != b && occupied(a) && occupied(b) &&
+           TileKind::matches(kind(a), kind(b)) && isOpen(a) && isOpen(b);
+  }
+
+  void appendMoves(std::vector<Move>* out) const { Moves::append(*this, out); }
+
+  // The position after removing a pair; the pair must be removable.
+  BoardSnapshot apply(const Move& move) const {
+    BoardSnapshot next = *this;
+    auto bits = std::make_shared<std::vector<uint64_t>>(*m_bits);
+    (*bits)[move.first / 64] &= ~bit(move.first);
+    (*bits)[move.second / 64] &= ~bit(move.second);
+    next.m_bits = std::move(bits);
+    next.m_remaining -= 2;
+    return next;
+  }
+
+  // The position after a shuffle with the given generator, drawing the same
+  // numbers as BoardState::shuffle().
+  BoardSnapshot shuffled(Rng& rng) const {
+    BoardState state = toState();
+    state.shuffle(rng);
+    BoardSnapshot next = *this;
+    next.m_kinds = std::make_shared<const std::vector<uint8_t>>(state.kinds());
+    return next;
+  }
+
+  // A mutable copy, for example to continue a game from a branch.
+  BoardState toState() const {
+    BoardState state(*m_layout);
+    for (int s = 0; s < size(); ++s) {
+      if (occupied(s)) state.set(s, (*m_kinds)[s]);
+    }
+    return state;
+  }
+
+  // True if both use the same storage, as copies of one snapshot do.
+  bool sharesStateWith(const BoardSnapshot& other) const {
+    return m_bits == other.m_bits && m_kinds == other.m_kinds;
+  }
+
+ private:
+  static size_t wordCount(int slots) { return size_t(slots + 63) / 64; }
+  static uint64_t bit(int slot) { return uint64_t(1) << (slot % 64); }
+
+  std::shared_ptr<const Layout> m_layout;
+  std::shared_ptr<const std::vector<uint8_t>> m_kinds;
+  std::shared_ptr<const std::vector<uint64_t>> m_bits;
+  int m_remaining = 0;
+};
+
+#endif  // BOARDSNAPSHOT_HPP
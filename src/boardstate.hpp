@@ -0,0 +1,257 @@
+#ifndef BOARDSTATE_HPP
+#define BOARDSTATE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "layout.hpp"
+#include "rng.hpp"
+#include "tilekind.hpp"
+
+/**
+ * @file boardstate.hpp
+ * @brief The position of a game: which kind sits in which layout slot.
+ *
+ * BoardState is the engine's view of a game without any Qt objects: one
+ * tile kind per layout slot, TileKind::None for slots whose tile has been
+ * removed. Board keeps one as the source of truth and mirrors it into Tile
+ * objects for QML; save files, replays and tools work on it directly.
+ */
+
+// A pair of slots removed together.
+struct Move {
+  int32_t first;
+  int32_t second;
+};
+
+/**
+ * The move generator, shared by every representation of a position
+ * (BoardState, BoardSnapshot). A position provides size(), occupied(),
+ * isOpen() and kind().
+ */
+namespace Moves {
+
+template <typename Position>
+void appendOpenSlots(const Position& p, std::vector<int32_t>* out) {
+  for (int s = 0; s < p.size(); ++s) {
+    if (p.occupied(s) && p.isOpen(s)) out->push_back(s);
+  }
+}
+
+// Appends every removable pair, grouped by match class and in slot order
+// within a class.
+template <typename Position>
+void append(const Position& p, std::vector<Move>* out) {
+  std::vector<int32_t> open;
+  appendOpenSlots(p, &open);
+  auto cls = [&p](int32_t slot) { return TileKind::matchClass(p.kind(slot)); };
+  std::stable_sort(open.begin(), open.end(),
+                   [&cls](int32_t a, int32_t b) { return cls(a) < cls(b); });
+  for (size_t i = 0; i < open.size(); ++i) {
+    for (size_t j = i + 1; j < open.size() && cls(open[j]) == cls(open[i]);
+         ++j)
+      out->push_back({open[i], open[j]});
+  }
+}
+
+}  // namespace Moves
+
+class BoardState {
+ public:
+  BoardState() = default;
+
+  // An empty board on the given layout.
+  explicit BoardState(const Layout& layout)
+      : m_layout(layout), m_kinds(layout.size(), TileKind::None) {}
+
+  const Layout& layout() const { return m_layout; }
+  int size() const { return int(m_kinds.size()); }
+  int remaining() const { return m_remaining; }
+  bool isCleared() const { return m_remaining == 0; }
+
+  const std::vector<uint8_t>& kinds() const { return m_kinds; }
+  int kind(int slot) const { return m_kinds[slot]; }
+  bool occupied(int slot) const { return m_kinds[slot] != TileKind::None; }
+
+  // The deck dealt into a layout of the given size: TileKind::deck()
+  // shuffled with the generator.
+  static std::vector<uint8_t> dealKinds(int slotCount, Rng& rng) {
+    std::vector<uint8_t> kinds = TileKind::deck(slotCount);
+    rng.shuffle(kinds.begin(), kinds.end());
+    return kinds;
+  }
+
+  // Empties the board and deals a fresh deck into it. An odd slot count
+  // leaves the last slot empty.
+  void deal(Rng& rng) {
+    const std::vector<uint8_t> kinds = dealKinds(size(), rng);
+    std::fill(m_kinds.begin(), m_kinds.end(), uint8_t(TileKind::None));
+    m_remaining = 0;
+    for (size_t i = 0; i < kinds.size(); ++i) set(int(i), kinds[i]);
+  }
+
+  // Puts a kind into a slot, or empties it with TileKind::None.
+  void set(int slot, int kind) {
+    m_remaining += (kind != TileKind::None) - occupied(slot);
+    m_kinds[slot] = uint8_t(kind);
+  }
+
+  bool isOpen(int slot) const {
+    return m_layout.isOpen(slot, [this](int s) { return occupied(s); });
+  }
+
+  // Highest occupied slot at a row and column, or -1.
+  int topmostAt(int row, int column) const {
+    return m_layout.topmostAt(row, column,
+                              [this](int s) { return occupied(s); });
+  }
+
+  // True if the two slots hold an open matching pair.
+  bool canRemove(int a, int b) const {
+    return a != b && occupied(a) && occupied(b) &&
+           TileKind::matches(kind(a), kind(b)) && isOpen(a) && isOpen(b);
+  }
+
+  // Appends the occupied open slots in slot order.
+  void appendOpenSlots(std::vector<int32_t>* out) const {
+    Moves::appendOpenSlots(*this, out);
+  }
+
+  // The move generator, see Moves::append().
+  void appendMoves(std::vector<Move>* out) const { Moves::append(*this, out); }
+
+  void removePair(int a, int b) {
+    set(a, TileKind::None);
+    set(b, TileKind::None);
+  }
+
+  // Redistributes the remaining kinds over the occupied slots. The result
+  // only depends on the position and the generator state. If given,
+  // @p permutation receives the move as used by permute().
+  void shuffle(Rng& rng, std::vector<int32_t>* permutation = nullptr) {
+    std::vector<int32_t> order(static_cast<size_t>(m_remaining));
+    for (size_t i = 0; i < order.size(); ++i) order[i] = int32_t(i);
+    rng.shuffle(order.begin(), order.end());
+    permute(order, false);
+    if (permutation) *permutation = std::move(order);
+  }
+
+  /**
+   * Like shuffle(), but the result can always be cleared, by construction:
+   * a random removal order of the occupied slots is drawn first, taking
+   * two slots that are open together at each step, and then every removed
+   * pair receives two matching kinds. Returns false if no such order was
+   * found in the given number of attempts (a lone stack can make one
+   * impossible); the position then gets a plain shuffle(). Costs about
+   * as much as shuffle() per attempt, as only the slots next to and below
+   * a removed pair are checked again.
+   */
+  bool solvableShuffle(Rng& rng, std::vector<int32_t>* permutation = nullptr,
+                       int attempts = 16) {
+    // Matching pairs of the occupied slots' indices, numbered in slot order.
+    std::vector<int32_t> slots, byClass;
+    for (int s = 0; s < size(); ++s) {
+      if (occupied(s)) slots.push_back(s);
+    }
+    byClass.resize(slots.size());
+    for (size_t i = 0; i < byClass.size(); ++i) byClass[i] = int32_t(i);
+    auto cls = [&](int32_t i) { return TileKind::matchClass(kind(slots[i])); };
+    std::stable_sort(byClass.begin(), byClass.end(),
+                     [&](int32_t a, int32_t b) { return cls(a) < cls(b); });
+    bool paired = byClass.size() % 2 == 0;
+    for (size_t i = 0; paired && i < byClass.size(); i += 2)
+      paired = cls(byClass[i]) == cls(byClass[i + 1]);
+
+    std::vector<int32_t> order;
+    for (int i = 0; paired && i < attempts; ++i) {
+      if (!randomRemovalOrder(rng, &order)) continue;
+      std::vector<int32_t> indexOf(size_t(size()), -1);
+      for (size_t j = 0; j < slots.size(); ++j) indexOf[slots[j]] = int32_t(j);
+      std::vector<int32_t> pairs(byClass.size() / 2);
+      for (size_t p = 0; p < pairs.size(); ++p) pairs[p] = int32_t(2 * p);
+      rng.shuffle(pairs.begin(), pairs.end());
+
+      std::vector<int32_t> moved(slots.size());
+      for (size_t p = 0; p < pairs.size(); ++p) {
+        moved[indexOf[order[2 * p]]] = byClass[pairs[p]];
+        moved[indexOf[order[2 * p + 1]]] = byClass[pairs[p] + 1];
+      }
+      permute(moved, false);
+      if (permutation) *permutation = std::move(moved);
+      return true;
+    }
+    shuffle(rng, permutation);
+    return false;
+  }
+
+  /**
+   * Rearranges the kinds of the occupied slots, numbered in slot order:
+   * occupied slot i receives the kind of occupied slot permutation[i], or
+   * with @p inverse gives its kind back to it.
+   */
+  void permute(const std::vector<int32_t>& permutation, bool inverse) {
+    std::vector<int32_t> slots;
+    std::vector<uint8_t> kinds;
+    slots.reserve(permutation.size());
+    kinds.reserve(permutation.size());
+    for (int s = 0; s < size(); ++s) {
+      if (!occupied(s)) continue;
+      slots.push_back(s);
+      kinds.push_back(m_kinds[s]);
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+      if (inverse)
+        m_kinds[slots[permutation[i]]] = kinds[i];
+      else
+        m_kinds[slots[i]] = kinds[permutation[i]];
+    }
+  }
+
+ private:
+  // Draws an order to remove the occupied slots in, two at a time, that
+  // the layout allows whatever the kinds: false if it ran into a position
+  // with fewer than two open slots.
+  bool randomRemovalOrder(Rng& rng, std::vector<int32_t>* order) const {
+    std::vector<char> present(m_kinds.size()), listed(m_kinds.size());
+    auto isPresent = [&present](int s) { return present[s] != 0; };
+    std::vector<int32_t> open;
+    for (int s = 0; s < size(); ++s) present[s] = occupied(s);
+    for (int s = 0; s < size(); ++s) {
+      if (present[s] && m_layout.isOpen(s, isPresent)) {
+        listed[s] = 1;
+        open.push_back(s);
+      }
+    }
+
+    order->clear();
+    while (int(order->size()) < m_remaining) {
+      if (open.size() < 2) return false;
+      for (int k = 0; k < 2; ++k) {
+        const size_t i = rng.bounded(uint32_t(open.size()));
+        present[open[i]] = 0;
+        order->push_back(open[i]);
+        open[i] = open.back();
+        open.pop_back();
+      }
+      // Removing tiles only opens others: their neighbours and the tiles
+      // they covered.
+      auto check = [&](int s) {
+        if (present[s] && !listed[s] && m_layout.isOpen(s, isPresent)) {
+          listed[s] = 1;
+          open.push_back(s);
+        }
+      };
+      m_layout.forEachAffected(order->end()[-2], check);
+      m_layout.forEachAffected(order->back(), check);
+    }
+    return true;
+  }
+
+  Layout m_layout;
+  std::vector<uint8_t> m_kinds;
+  int m_remaining = 0;
+};
+
+#endif  // BOARDSTATE_HPP
@@ -0,0 +1,197 @@
+#ifndef DEALDATABASE_HPP
+#define DEALDATABASE_HPP
+
+#include <QFile>
+#include <QString>
+#include <QSysInfo>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "layout.hpp"
+
+/**
+ * @file dealdatabase.hpp
+ * @brief A memory-mapped file of pre-generated deals.
+ *
+ * The file starts with a fixed header followed by fixed-size records, so
+ * deal i lives at a known offset and can be read straight from the mapping
+ * without any parsing:
+ *
+ *   Header  magic "MJDD", version, slot count, record size, deal count,
+ *           layout fingerprint (see Layout::fingerprint()), first seed
+ *           (deal i is the deal Board makes for seed first seed + i)
+ *   Record  layout id (low 32 bits of the fingerprint), solvability,
+ *           difficulty (0..255, 0 when unknown), one tile kind per slot,
+ *           padded to a multiple of 8 bytes
+ *
+ * All integers are little-endian, the byte order of every platform the game
+ * runs on, so records are used as they are. DealDatabaseWriter streams
+ * records to a file, so databases with millions of deals never need to fit
+ * in memory.
+ */
+
+static_assert(QSysInfo::ByteOrder == QSysInfo::LittleEndian,
+              "Deal databases are read in place as little-endian data");
+
+namespace DealFormat {
+
+constexpr uint32_t Magic = 0x44444a4d;  // "MJDD"
+constexpr uint32_t Version = 2;  // 2: first seed
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t recordSize;
+  uint64_t dealCount;
+  uint64_t layoutFingerprint;
+  uint64_t firstSeed;
+};
+
+struct RecordHeader {
+  uint32_t layoutId;
+  uint8_t solvability;
+  uint8_t difficulty;
+  uint16_t reserved;
+};
+
+inline uint32_t recordSize(uint32_t slotCount) {
+  return (sizeof(RecordHeader) + slotCount + 7) & ~7u;
+}
+
+}  // namespace DealFormat
+
+enum class Solvability : uint8_t { Unknown = 0, Solvable = 1, Unsolvable = 2 };
+
+struct Deal {
+  uint32_t layoutId = 0;
+  Solvability solvability = Solvability::Unknown;
+  uint8_t difficulty = 0;
+  const uint8_t* kinds = nullptr;  // slotCount kinds, points into the file
+};
+
+class DealDatabase {
+ public:
+  bool open(const QString& path, QString* error = nullptr) {
+    auto fail = [error](const QString& message) {
+      if (error) *error = message;
+      return false;
+    };
+
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly))
+      return fail(QString("Cannot open %1").arg(path));
+    if (file->size() < qint64(sizeof(DealFormat::Header)))
+      return fail("File too small");
+
+    uchar* data = file->map(0, file->size());
+    if (!data) return fail("Cannot map file");
+
+    DealFormat::Header header;
+    std::memcpy(&header, data, sizeof header);
+    if (header.magic != DealFormat::Magic) return fail("Not a deal database");
+    if (header.version != DealFormat::Version)
+      return fail(QString("Unsupported deal database version %1")
+                      .arg(header.version));
+    if (header.recordSize != DealFormat::recordSize(header.slotCount))
+      return fail("Bad record size");
+    const uint64_t available =
+        (uint64_t(file->size()) - sizeof header) / header.recordSize;
+    if (header.dealCount > available) return fail("Truncated deal database");
+
+    m_header = header;
+    m_records = data + sizeof header;
+    m_file = file;
+    return true;
+  }
+
+  bool isOpen() const { return m_file != nullptr; }
+  qint64 count() const { return qint64(m_header.dealCount); }
+  int slotCount() const { return int(m_header.slotCount); }
+  uint64_t layoutFingerprint() const { return m_header.layoutFingerprint; }
+
+  // The seed the deal at an index was dealt from.
+  uint64_t seed(qint64 index) const {
+    return m_header.firstSeed + uint64_t(index);
+  }
+
+  // True if the deals were made for the given layout.
+  bool matches(const Layout& layout) const {
+    return isOpen() && layout.size() == slotCount() &&
+           layout.fingerprint() == layoutFingerprint();
+  }
+
+  // O(1): the record is read in place from the mapping.
+  Deal deal(qint64 index) const {
+    const uchar* record = m_records + uint64_t(index) * m_header.recordSize;
+    DealFormat::RecordHeader rh;
+    std::memcpy(&rh, record, sizeof rh);
+
+    Deal d;
+    d.layoutId = rh.layoutId;
+    d.solvability = Solvability(rh.solvability);
+    d.difficulty = rh.difficulty;
+    d.kinds = record + sizeof rh;
+    return d;
+  }
+
+ private:
+  std::shared_ptr<QFile> m_file;  // Unmaps on destruction
+  DealFormat::Header m_header = {};
+  const uchar* m_records = nullptr;
+};
+
+class DealDatabaseWriter {
+ public:
+  // Deal i must be the one Board deals for seed firstSeed + i.
+  bool open(const QString& path, const Layout& layout, uint64_t firstSeed) {
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    m_header = {DealFormat::Magic,
+                DealFormat::Version,
+                uint32_t(layout.size()),
+                DealFormat::recordSize(layout.size()),
+                0,
+                layout.fingerprint(),
+                firstSeed};
+    m_record.assign(m_header.recordSize, 0);
+    return writeHeader();
+  }
+
+  bool append(const std::vector<uint8_t>& kinds, Solvability solvability,
+              uint8_t difficulty) {
+    if (kinds.size() > m_header.slotCount) return false;
+    DealFormat::RecordHeader rh = {uint32_t(m_header.layoutFingerprint),
+                                   uint8_t(solvability), difficulty, 0};
+    std::fill(m_record.begin(), m_record.end(), 0);
+    std::memcpy(m_record.data(), &rh, sizeof rh);
+    std::memcpy(m_record.data() + sizeof rh, kinds.data(), kinds.size());
+    if (m_file.write(m_record.data(), m_record.size()) !=
+        qint64(m_record.size()))
+      return false;
+    ++m_header.dealCount;
+    return true;
+  }
+
+  // Writes the final deal count into the header.
+  bool finish() {
+    bool ok = m_file.seek(0) && writeHeader();
+    m_file.close();
+    return ok;
+  }
+
+ private:
+  bool writeHeader() {
+    return m_file.write(reinterpret_cast<const char*>(&m_header),
+                        sizeof m_header) == qint64(sizeof m_header);
+  }
+
+  QFile m_file;
+  DealFormat::Header m_header = {};
+  std::vector<char> m_record;
+};
+
+#endif  // DEALDATABASE_HPP
@@ -0,0 +1,258 @@
+#ifndef DIFFICULTY_HPP
+#define DIFFICULTY_HPP
+
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "rng.hpp"
+#include "solver.hpp"
+#include "winestimator.hpp"
+
+/**
+ * @file difficulty.hpp
+ * @brief Rates how hard a deal is, from 0 (easy) to 1.
+ *
+ * A rating combines what the exact solver sees with how well simple
+ * players do:
+ *
+ * - The solver runs with a small node limit. The share of the positions
+ *   it searched that had no pair left (dead ends) and the pairs per
+ *   position (the branching factor) describe the tree: few choices and
+ *   many dead ends make a deal hard.
+ * - Random playouts (WinEstimate::playout) and greedy ones (the highest
+ *   pair first, as the simulator plays, ties broken at random) give two
+ *   win rates. The random playouts also estimate how many of all the
+ *   games from the position are won (Knuth's estimator: a playout stands
+ *   for the product of the pairs it chose from). That share counts every
+ *   game alike, where the random win rate favours games with few choices.
+ *
+ * Every term is a hardness from 0 to 1 and the score is their weighted
+ * mean (Options::weights). A deal the solver proves unsolvable scores 1;
+ * one it gave up on but a playout cleared is solvable.
+ *
+ * Playouts run in chunks, each with its own generator seeded from the
+ * chunk number, and chunk results are added in order, so a rating only
+ * depends on the position and the options, not on the threads. rate()
+ * spreads the chunks of one deal over the pool while the calling thread
+ * runs the solver; with the default options a turtle deal takes about
+ * 80 ms of CPU time, which all cores share, so it can be rated while a
+ * new game is laid out.
+ * rateAll() rates many deals, one deal per pool thread. Neither may be
+ * called from a thread of the rater's pool.
+ */
+
+struct DifficultyRating {
+  Solver::Status status = Solver::Status::Unknown;
+  int64_t nodes = 0;
+  double branching = 0.0;  // Pairs per position the solver searched
+  double deadEndRate = 0.0;  // Share of those positions without a pair
+  double randomWinRate = 0.0;
+  double greedyWinRate = 0.0;
+  // Estimated games from the position (base 10 logarithm), and the share
+  // of them that clear the board.
+  double gamesLog10 = 0.0;
+  double wonGames = 0.0;
+  double score = 0.0;
+
+  // The score as a deal database difficulty, 1..255 (0 is unrated).
+  uint8_t difficulty() const {
+    return uint8_t(1 + std::lround(std::clamp(score, 0.0, 1.0) * 254));
+  }
+};
+
+class DifficultyRater {
+ public:
+  struct Weights {
+    double randomPlay = 3;
+    double greedyPlay = 2;
+    double wonGames = 2;
+    double branching = 1;
+    double deadEnds = 1;
+  };
+
+  struct Options {
+    int64_t nodeLimit = 10000;
+    int playouts = 256;  // Random ones, and as many greedy ones
+    int chunkSize = 64;
+    uint64_t seed = 1;
+    Weights weights;
+  };
+
+  DifficultyRater() = default;
+  // The pool must outlive the rater.
+  explicit DifficultyRater(const Options& options,
+                           QThreadPool* pool = QThreadPool::globalInstance())
+      : m_options(options), m_pool(pool) {}
+
+  const Options& options() const { return m_options; }
+
+  // Rates one position with all threads of the pool.
+  DifficultyRating rate(const BoardState& state) const {
+    const int count = chunkCount();
+    std::vector<Chunk> chunks(static_cast<size_t>(count));
+    QSemaphore done;
+    for (int c = 0; c < count; ++c) {
+      m_pool->start([this, &state, &chunks, &done, c] {
+        chunks[size_t(c)] = play(state, c);
+        done.release();
+      });
+    }
+    Solver solver(solverOptions());
+    const Solver::Result solved = solver.solve(state);
+    done.acquire(count);
+    return combine(solved, chunks);
+  }
+
+  // Rates one position on the calling thread; the same as rate().
+  DifficultyRating rateHere(const BoardState& state) const {
+    Solver solver(solverOptions());
+    return rateWith(&solver, state);
+  }
+
+  // Rates many positions, one per thread of the pool at a time.
+  std::vector<DifficultyRating> rateAll(
+      const std::vector<BoardState>& states) const {
+    std::vector<DifficultyRating> ratings(states.size());
+    std::atomic<size_t> next{0};
+    QSemaphore done;
+    const int workers =
+        int(std::min<size_t>(size_t(std::max(1, m_pool->maxThreadCount())),
+                             states.size()));
+    for (int w = 0; w < workers; ++w) {
+      m_pool->start([this, &states, &ratings, &next, &done] {
+        Solver solver(solverOptions());  // Its table is kept between deals
+        for (size_t i; (i = next++) < states.size();)
+          ratings[i] = rateWith(&solver, states[i]);
+        done.release();
+      });
+    }
+    done.acquire(workers);
+    return ratings;
+  }
+
+ private:
+  struct Chunk {
+    int randomWins = 0;
+    int greedyWins = 0;
+    double games = 0.0;  // Sum of the games the random playouts stand for
+    double wonGames = 0.0;  // ... over the won ones
+  };
+
+  int chunkCount() const {
+    const int size = std::max(1, m_options.chunkSize);
+    return (std::max(0, m_options.playouts) + size - 1) / size;
+  }
+
+  Solver::Options solverOptions() const {
+    Solver::Options options;
+    options.nodeLimit = m_options.nodeLimit;
+    options.tableBytes = int64_t(1) << 20;  // Plenty for the node limit
+    return options;
+  }
+
+  DifficultyRating rateWith(Solver* solver, const BoardState& state) const {
+    std::vector<Chunk> chunks(static_cast<size_t>(chunkCount()));
+    for (size_t c = 0; c < chunks.size(); ++c) chunks[c] = play(state, int(c));
+    return combine(solver->solve(state), chunks);
+  }
+
+  Chunk play(const BoardState& state, int chunk) const {
+    const int size = std::max(1, m_options.chunkSize);
+    const int count = std::min(size, m_options.playouts - chunk * size);
+    Rng rng(m_options.seed + uint64_t(chunk));
+    std::vector<Move> scratch;
+    Chunk result;
+    for (int i = 0; i < count; ++i) {
+      double games = 1.0;
+      const bool won = WinEstimate::playout(state, rng, &scratch, &games);
+      result.randomWins += won ? 1 : 0;
+      result.games += games;
+      if (won) result.wonGames += games;
+      result.greedyWins += greedyPlayout(state, rng, &scratch) ? 1 : 0;
+    }
+    return result;
+  }
+
+  // Removes the highest pair until none is left; true if cleared.
+  static bool greedyPlayout(BoardState state, Rng& rng,
+                            std::vector<Move>* scratch) {
+    const Layout& layout = state.layout();
+    while (!state.isCleared()) {
+      scratch->clear();
+      state.appendMoves(scratch);
+      if (scratch->empty()) return false;
+      const Move* best = nullptr;
+      int bestHeight = -1;
+      uint32_t ties = 0;
+      for (const Move& m : *scratch) {
+        const int height =
+            layout.slot(m.first).layer + layout.slot(m.second).layer;
+        if (height > bestHeight) {
+          best = &m;
+          bestHeight = height;
+          ties = 1;
+        } else if (height == bestHeight && rng.bounded(++ties) == 0) {
+          best = &m;
+        }
+      }
+      state.removePair(best->first, best->second);
+    }
+    return true;
+  }
+
+  DifficultyRating combine(const Solver::Result& solved,
+                           const std::vector<Chunk>& chunks) const {
+    DifficultyRating r;
+    r.status = solved.status;
+    r.nodes = solved.nodes;
+    if (solved.nodes > 0) {
+      r.branching = double(solved.pairs) / double(solved.nodes);
+      r.deadEndRate = double(solved.deadEnds) / double(solved.nodes);
+    }
+
+    Chunk total;
+    for (const Chunk& c : chunks) {
+      total.randomWins += c.randomWins;
+      total.greedyWins += c.greedyWins;
+      total.games += c.games;
+      total.wonGames += c.wonGames;
+    }
+    const int playouts = std::max(0, m_options.playouts);
+    if (playouts > 0) {
+      r.randomWinRate = double(total.randomWins) / playouts;
+      r.greedyWinRate = double(total.greedyWins) / playouts;
+      r.gamesLog10 = std::log10(total.games / playouts);
+    }
+    if (total.games > 0) r.wonGames = total.wonGames / total.games;
+    if (r.status == Solver::Status::Unknown &&
+        total.randomWins + total.greedyWins > 0)
+      r.status = Solver::Status::Solvable;  // A playout cleared it
+
+    if (r.status == Solver::Status::Unsolvable) {
+      r.score = 1.0;
+      return r;
+    }
+    const Weights& w = m_options.weights;
+    const double sum =
+        w.randomPlay + w.greedyPlay + w.wonGames + w.branching + w.deadEnds;
+    if (sum <= 0) return r;
+    r.score = (w.randomPlay * (1.0 - r.randomWinRate) +
+               w.greedyPlay * (1.0 - r.greedyWinRate) +
+               w.wonGames * (1.0 - r.wonGames) +
+               w.branching / std::max(1.0, r.branching) +
+               w.deadEnds * r.deadEndRate) /
+              sum;
+    return r;
+  }
+
+  Options m_options;
+  QThreadPool* m_pool = QThreadPool::globalInstance();
+};
+
+#endif  // DIFFICULTY_HPP
@@ -0,0 +1,404 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @file layout.hpp
+ * @brief Declares the Layout class describing where tiles can be placed.
+ *
+ * A layout is an ordered list of slots, each with a row, column and layer.
+ * The Board deals one tile into every slot when a game starts. Besides the
+ * classic turtle, layouts of arbitrary size can be generated for testing
+ * how the engine scales with the number of tiles, and layouts can be loaded
+ * from files (see LayoutLoader).
+ *
+ * When a layout is built it is compiled into one contiguous, position
+ * independent block of memory holding the slots and the two relations the
+ * game rules need:
+ *  - the cover graph: slots sharing a row and column form a stack ordered
+ *    by layer, and a slot is covered while any slot above it is occupied;
+ *  - the neighbour graph: the slots directly left and right of each slot on
+ *    the same layer.
+ * The block can be written to disk as is and used again straight from a
+ * memory mapping, see fromBinary().
+ */
+
+struct LayoutSlot {
+  int32_t row;
+  int32_t column;
+  int32_t layer;
+};
+
+class Layout {
+ public:
+  static constexpr uint32_t Magic = 0x434c4a4d;  // "MJLC"
+  static constexpr uint32_t Version = 1;
+
+  Layout() = default;
+
+  // Compiles a layout. Slots must have distinct positions.
+  Layout(std::string name, const std::vector<LayoutSlot>& slots,
+         uint64_t sourceHash = 0) {
+    compile(name, slots, sourceHash);
+  }
+
+  const std::string& name() const { return m_name; }
+  int size() const { return m_header ? int(m_header->slotCount) : 0; }
+  bool isEmpty() const { return size() == 0; }
+  const LayoutSlot& slot(int index) const { return m_slots[index]; }
+
+  int layerCount() const {
+    int layers = 0;
+    for (int i = 0; i < size(); ++i)
+      layers = std::max(layers, m_slots[i].layer + 1);
+    return layers;
+  }
+
+  // Hash of the file the layout was compiled from, 0 for built-in ones.
+  uint64_t sourceHash() const { return m_header ? m_header->sourceHash : 0; }
+
+  // FNV-1a over the slot positions; identifies a layout independently of
+  // where it was loaded from.
+  uint64_t fingerprint() const {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < size(); ++i) {
+      const int32_t values[] = {m_slots[i].row, m_slots[i].column,
+                                m_slots[i].layer};
+      const unsigned char* bytes =
+          reinterpret_cast<const unsigned char*>(values);
+      for (size_t b = 0; b < sizeof values; ++b) {
+        h ^= bytes[b];
+        h *= 0x100000001b3ULL;
+      }
+    }
+    return h;
+  }
+
+  // Neighbours on the same layer and row, or -1.
+  int left(int index) const { return m_left[index]; }
+  int right(int index) const { return m_right[index]; }
+
+  // Slots sharing the cell of the given slot, bottom layer first.
+  const int32_t* stackBegin(int index) const {
+    return m_cellSlots + m_cellOffsets[m_slotCell[index]];
+  }
+  const int32_t* stackEnd(int index) const {
+    return m_cellSlots + m_cellOffsets[m_slotCell[index] + 1];
+  }
+
+  // Slot at an exact position, or -1.
+  int slotAt(int row, int column, int layer) const {
+    int cell = findCell(row, column);
+    if (cell < 0) return -1;
+    for (uint32_t i = m_cellOffsets[cell]; i < m_cellOffsets[cell + 1]; ++i) {
+      if (m_slots[m_cellSlots[i]].layer == layer) return m_cellSlots[i];
+    }
+    return -1;
+  }
+
+  // Highest occupied slot at a row and column, or -1.
+  template <typename Occupied>
+  int topmostAt(int row, int column, Occupied occupied) const {
+    int cell = findCell(row, column);
+    if (cell < 0) return -1;
+    for (uint32_t i = m_cellOffsets[cell + 1]; i > m_cellOffsets[cell]; --i) {
+      if (occupied(m_cellSlots[i - 1])) return m_cellSlots[i - 1];
+    }
+    return -1;
+  }
+
+  /**
+   * The open rule: a slot is open when no occupied slot lies above it and
+   * at least one of its left and right neighbours is empty. @p occupied is
+   * called with slot indices and tells which slots still hold a tile.
+   */
+  template <typename Occupied>
+  bool isOpen(int index, Occupied occupied) const {
+    for (const int32_t* s = stackEnd(index) - 1; *s != index; --s) {
+      if (occupied(*s)) return false;
+    }
+    int l = m_left[index];
+    int r = m_right[index];
+    return l < 0 || r < 0 || !occupied(l) || !occupied(r);
+  }
+
+  // Calls f for every slot whose open state may change when the given slot
+  // is emptied or filled: the side neighbours and the slots below it.
+  template <typename F>
+  void forEachAffected(int index, F f) const {
+    if (m_left[index] >= 0) f(m_left[index]);
+    if (m_right[index] >= 0) f(m_right[index]);
+    for (const int32_t* s = stackBegin(index); *s != index; ++s) f(*s);
+  }
+
+  // The compiled block, suitable for writing to a cache file.
+  const char* data() const { return m_data; }
+  size_t byteSize() const { return m_bytes; }
+
+  /**
+   * Uses a compiled block without copying it. @p keepAlive owns the memory
+   * (for example a memory mapping) and is kept for the lifetime of the
+   * layout and its copies. Returns false if the block is not a valid
+   * compiled layout.
+   */
+  static bool fromBinary(const char* data, size_t bytes,
+                         std::shared_ptr<const void> keepAlive, Layout* out) {
+    Layout layout;
+    if (!layout.attach(data, bytes)) return false;
+    layout.m_storage = std::move(keepAlive);
+    *out = std::move(layout);
+    return true;
+  }
+
+  // The 144-slot turtle used by the game.
+  static Layout turtle() {
+    std::vector<LayoutSlot> slots;
+    slots.reserve(144);
+    // Each layer is a rectangle of rows x columns, stacked towards the
+    // centre; the last layer is the single tile on top.
+    const struct {
+      int firstRow, lastRow, firstColumn, lastColumn;
+    } layers[] = {{3, 10, 3, 11}, {4, 9, 4, 10}, {5, 8, 5, 9},
+                  {6, 8, 6, 8},   {7, 7, 7, 7}};
+    for (int l = 0; l < 5; ++l) {
+      for (int r = layers[l].firstRow; r <= layers[l].lastRow; ++r) {
+        for (int c = layers[l].firstColumn; c <= layers[l].lastColumn; ++c)
+          slots.push_back({r, c, l});
+      }
+    }
+    return Layout("turtle", slots);
+  }
+
+  /**
+   * Generates a stepped pyramid with exactly @p slotCount slots (rounded
+   * down to an even number) spread over at most @p layers layers. Every
+   * layer is one tile smaller on each side than the one below it, like the
+   * turtle, and the base is made just large enough to hold all slots.
+   */
+  static Layout synthetic(int slotCount, int layers) {
+    slotCount -= slotCount % 2;
+    layers = std::max(1, layers);
+
+    auto capacity = [layers](int base) {
+      long long total = 0;
+      for (int l = 0; l < layers; ++l) {
+        int side = base - 2 * l;
+        if (side <= 0) break;
+        total += static_cast<long long>(side) * side;
+      }
+      return total;
+    };
+
+    int base = 1;
+    while (capacity(base) < slotCount) ++base;
+
+    std::vector<LayoutSlot> slots;
+    slots.reserve(slotCount);
+    for (int l = 0; l < layers && static_cast<int>(slots.size()) < slotCount;
+         ++l) {
+      int side = base - 2 * l;
+      for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+          if (static_cast<int>(slots.size()) == slotCount) break;
+          slots.push_back({r + l, c + l, l});
+        }
+      }
+    }
+    return Layout("synthetic-" + std::to_string(slotCount), slots);
+  }
+
+ private:
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t slotCount;
+    uint32_t cellCount;
+    uint32_t nameLength;
+    uint32_t reserved;
+  };
+
+  static uint64_t cellKey(int row, int column) {
+    return (uint64_t(uint32_t(row)) << 32) | uint32_t(column);
+  }
+
+  static size_t pad(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+  // Byte offsets of the sections that follow the header.
+  struct Sections {
+    size_t cellKeys, cellOffsets, cellSlots, slots, slotCell, left, right,
+        name, total;
+
+    Sections(uint32_t slotCount, uint32_t cellCount, uint32_t nameLength) {
+      size_t at = sizeof(Header);
+      cellKeys = at;
+      at += pad(sizeof(uint64_t) * cellCount);
+      cellOffsets = at;
+      at += pad(sizeof(uint32_t) * (size_t(cellCount) + 1));
+      cellSlots = at;
+      at += pad(sizeof(int32_t) * slotCount);
+      slots = at;
+      at += pad(sizeof(LayoutSlot) * slotCount);
+      slotCell = at;
+      at += pad(sizeof(int32_t) * slotCount);
+      left = at;
+      at += pad(sizeof(int32_t) * slotCount);
+      right = at;
+      at += pad(sizeof(int32_t) * slotCount);
+      name = at;
+      at += pad(nameLength);
+      total = at;
+    }
+  };
+
+  int findCell(int row, int column) const {
+    if (!m_header) return -1;
+    const uint64_t key = cellKey(row, column);
+    const uint64_t* end = m_cellKeys + m_header->cellCount;
+    const uint64_t* it = std::lower_bound(m_cellKeys, end, key);
+    return (it != end && *it == key) ? int(it - m_cellKeys) : -1;
+  }
+
+  void compile(const std::string& name, const std::vector<LayoutSlot>& slots,
+               uint64_t sourceHash) {
+    const uint32_t n = uint32_t(slots.size());
+
+    // Order slots by cell, then by layer, to form the stacks.
+    std::vector<int32_t> order(n);
+    for (uint32_t i = 0; i < n; ++i) order[i] = int32_t(i);
+    std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b) {
+      uint64_t ka = cellKey(slots[a].row, slots[a].column);
+      uint64_t kb = cellKey(slots[b].row, slots[b].column);
+      return ka != kb ? ka < kb : slots[a].layer < slots[b].layer;
+    });
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> offsets;
+    std::vector<int32_t> slotCell(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      const LayoutSlot& s = slots[order[i]];
+      uint64_t key = cellKey(s.row, s.column);
+      if (keys.empty() || keys.back() != key) {
+        keys.push_back(key);
+        offsets.push_back(i);
+      }
+      slotCell[order[i]] = int32_t(keys.size() - 1);
+    }
+    offsets.push_back(n);
+
+    Sections sec(n, uint32_t(keys.size()), uint32_t(name.size()));
+    auto block = std::make_shared<std::vector<char>>(sec.total, 0);
+    char* base = block->data();
+
+    Header header = {Magic, Version, sourceHash, n, uint32_t(keys.size()),
+                     uint32_t(name.size()), 0};
+    std::memcpy(base, &header, sizeof header);
+    std::memcpy(base + sec.cellKeys, keys.data(), keys.size() * 8);
+    std::memcpy(base + sec.cellOffsets, offsets.data(), offsets.size() * 4);
+    std::memcpy(base + sec.cellSlots, order.data(), n * 4);
+    std::memcpy(base + sec.slots, slots.data(), n * sizeof(LayoutSlot));
+    std::memcpy(base + sec.slotCell, slotCell.data(), n * 4);
+    std::memcpy(base + sec.name, name.data(), name.size());
+
+    // Attach first so that slotAt() can be used to find the neighbours.
+    attach(base, sec.total);
+    m_storage = block;
+
+    int32_t* left = reinterpret_cast<int32_t*>(base + sec.left);
+    int32_t* right = reinterpret_cast<int32_t*>(base + sec.right);
+    for (uint32_t i = 0; i < n; ++i) {
+      const LayoutSlot& s = slots[i];
+      left[i] = slotAt(s.row, s.column - 1, s.layer);
+      right[i] = slotAt(s.row, s.column + 1, s.layer);
+    }
+  }
+
+  // Points the accessors into a compiled block after validating it.
+  bool attach(const char* data, size_t bytes) {
+    if (bytes < sizeof(Header)) return false;
+    const Header* h = reinterpret_cast<const Header*>(data);
+    if (h->magic != Magic || h->version != Version) return false;
+    if (h->cellCount > h->slotCount) return false;
+
+    Sections sec(h->slotCount, h->cellCount, h->nameLength);
+    if (bytes < sec.total) return false;
+
+    const uint32_t* offsets =
+        reinterpret_cast<const uint32_t*>(data + sec.cellOffsets);
+    const int32_t* cellSlots =
+        reinterpret_cast<const int32_t*>(data + sec.cellSlots);
+    const int32_t* slotCell =
+        reinterpret_cast<const int32_t*>(data + sec.slotCell);
+    const int32_t* left = reinterpret_cast<const int32_t*>(data + sec.left);
+    const int32_t* right = reinterpret_cast<const int32_t*>(data + sec.right);
+
+    // Reject anything that would index out of range later on.
+    if (offsets[0] != 0 || offsets[h->cellCount] != h->slotCount) return false;
+    const uint64_t* keys =
+        reinterpret_cast<const uint64_t*>(data + sec.cellKeys);
+    for (uint32_t c = 0; c < h->cellCount; ++c) {
+      if (offsets[c] >= offsets[c + 1]) return false;
+      if (c > 0 && keys[c - 1] >= keys[c]) return false;
+    }
+    const int32_t n = int32_t(h->slotCount);
+    for (int32_t i = 0; i < n; ++i) {
+      if (cellSlots[i] < 0 || cellSlots[i] >= n) return false;
+      if (slotCell[i] < 0 || uint32_t(slotCell[i]) >= h->cellCount)
+        return false;
+      if (left[i] < -1 || left[i] >= n || right[i] < -1 || right[i] >= n)
+        return false;
+    }
+    // isOpen() and forEachAffected() walk a stack until they meet the
+    // slot, so every slot must be in its own cell's stack exactly once,
+    // bottom layer first.
+    const LayoutSlot* slots =
+        reinterpret_cast<const LayoutSlot*>(data + sec.slots);
+    std::vector<bool> seen(size_t(n), false);
+    for (uint32_t c = 0; c < h->cellCount; ++c) {
+      for (uint32_t i = offsets[c]; i < offsets[c + 1]; ++i) {
+        const int32_t s = cellSlots[i];
+        if (seen[size_t(s)] || uint32_t(slotCell[s]) != c ||
+            cellKey(slots[s].row, slots[s].column) != keys[c])
+          return false;
+        if (i > offsets[c] && slots[cellSlots[i - 1]].layer > slots[s].layer)
+          return false;
+        seen[size_t(s)] = true;
+      }
+    }
+
+    m_data = data;
+    m_bytes = sec.total;
+    m_header = h;
+    m_cellKeys = keys;
+    m_cellOffsets = offsets;
+    m_cellSlots = cellSlots;
+    m_slots = slots;
+    m_slotCell = slotCell;
+    m_left = left;
+    m_right = right;
+    m_name.assign(data + sec.name, h->nameLength);
+    return true;
+  }
+
+  std::shared_ptr<const void> m_storage;
+  const char* m_data = nullptr;
+  size_t m_bytes = 0;
+  const Header* m_header = nullptr;
+  const uint64_t* m_cellKeys = nullptr;
+  const uint32_t* m_cellOffsets = nullptr;
+  const int32_t* m_cellSlots = nullptr;
+  const LayoutSlot* m_slots = nullptr;
+  const int32_t* m_slotCell = nullptr;
+  const int32_t* m_left = nullptr;
+  const int32_t* m_right = nullptr;
+  std::string m_name;
+};
+
+#endif  // LAYOUT_HPP
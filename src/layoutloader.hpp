@@ -0,0 +1,195 @@
+#ifndef LAYOUTLOADER_HPP
+#define LAYOUTLOADER_HPP
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QString>
+#include <QtEndian>
+#include <memory>
+#include <set>
+#include <tuple>
+
+#include "layout.hpp"
+
+/**
+ * @file layoutloader.hpp
+ * @brief Loads layouts from KMahjongg layout files, with a compiled cache.
+ *
+ * Both versions of the KMahjongg text format are understood:
+ *
+ *   kmahjongg-layout-v1.0        kmahjongg-layout-v1.1
+ *   <16 lines per layer> x 5     w<width> h<height> d<depth> lines, then
+ *                                <height lines per layer> x depth
+ *
+ * Lines starting with '#' are comments. KMahjongg works on a half-tile
+ * grid where a tile covers 2x2 characters; '1' marks the top left corner of
+ * a tile and '2', '3', '4' its other corners. The engine places tiles on a
+ * whole-tile grid, so a corner at character (x, y) becomes row y / 2 and
+ * column x / 2; tiles at half offsets are snapped down. Layouts whose tiles
+ * collide after snapping are rejected.
+ *
+ * A parsed layout is compiled (see Layout) and the compiled block is stored
+ * in the cache directory under the hash of the file contents. Later loads of
+ * the same file memory-map that block instead of parsing it again.
+ */
+
+class LayoutLoader {
+ public:
+  explicit LayoutLoader(const QString& cacheDir = defaultCacheDir())
+      : m_cacheDir(cacheDir) {}
+
+  static QString defaultCacheDir() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           "/layouts";
+  }
+
+  QString cacheDir() const { return m_cacheDir; }
+
+  // True if the last successful load() came from the cache.
+  bool lastLoadWasCached() const { return m_lastCached; }
+
+  /**
+   * Loads a layout file. Returns an empty layout and sets @p error if the
+   * file cannot be read or is not a valid layout.
+   */
+  Layout load(const QString& path, QString* error = nullptr) {
+    m_lastCached = false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+      if (error) *error = QString("Cannot open %1").arg(path);
+      return Layout();
+    }
+    const QByteArray text = file.readAll();
+
+    const QByteArray digest =
+        QCryptographicHash::hash(text, QCryptographicHash::Sha256);
+    const quint64 hash = qFromLittleEndian<quint64>(digest.constData());
+    const QString cachePath = m_cacheDir + "/" +
+                              QString::fromLatin1(digest.left(16).toHex()) +
+                              ".mjlc";
+
+    Layout layout;
+    if (!m_cacheDir.isEmpty() && mapCached(cachePath, hash, &layout)) {
+      m_lastCached = true;
+      return layout;
+    }
+
+    layout = parseKMahjongg(text, QFileInfo(path).completeBaseName(), hash,
+                            error);
+    if (layout.isEmpty()) return layout;
+
+    if (!m_cacheDir.isEmpty()) writeCache(cachePath, layout);
+    return layout;
+  }
+
+  static Layout parseKMahjongg(const QByteArray& text, const QString& name,
+                               quint64 sourceHash, QString* error) {
+    auto fail = [error](const QString& message) {
+      if (error) *error = message;
+      return Layout();
+    };
+
+    QList<QByteArray> lines;
+    for (QByteArray line : text.split('\n')) {
+      line = line.trimmed();
+      if (line.isEmpty() || line.startsWith('#')) continue;
+      lines.append(line);
+    }
+    if (lines.isEmpty()) return fail("Empty layout file");
+
+    int width = 32;
+    int height = 16;
+    int depth = 5;
+    int at = 1;
+    if (lines[0] == "kmahjongg-layout-v1.1") {
+      // Header lines like "w32" in any order before the grid.
+      while (at < lines.size() && !lines[at].isEmpty() &&
+             QByteArray("whd").contains(lines[at][0])) {
+        int value = lines[at].mid(1).toInt();
+        if (value <= 0)
+          return fail("Bad header line: " + QString::fromLatin1(lines[at]));
+        switch (lines[at][0]) {
+          case 'w':
+            width = value;
+            break;
+          case 'h':
+            height = value;
+            break;
+          default:
+            depth = value;
+            break;
+        }
+        ++at;
+      }
+    } else if (lines[0] != "kmahjongg-layout-v1.0") {
+      return fail("Not a KMahjongg layout file");
+    }
+
+    if (lines.size() - at < height * depth)
+      return fail(QString("Expected %1 grid lines, found %2")
+                      .arg(height * depth)
+                      .arg(lines.size() - at));
+
+    std::vector<LayoutSlot> slots;
+    std::set<std::tuple<int, int, int>> taken;
+    for (int layer = 0; layer < depth; ++layer) {
+      for (int y = 0; y < height; ++y) {
+        const QByteArray& line = lines[at + layer * height + y];
+        for (int x = 0; x < qMin(width, int(line.size())); ++x) {
+          if (line[x] != '1') continue;
+          LayoutSlot slot = {y / 2, x / 2, layer};
+          if (!taken.insert({slot.row, slot.column, slot.layer}).second)
+            return fail(QString("Tiles collide at row %1, column %2, "
+                                "layer %3")
+                            .arg(slot.row)
+                            .arg(slot.column)
+                            .arg(layer));
+          slots.push_back(slot);
+        }
+      }
+    }
+
+    if (slots.empty()) return fail("Layout has no tiles");
+    if (slots.size() % 2) return fail("Layout has an odd number of tiles");
+    return Layout(name.toStdString(), slots, sourceHash);
+  }
+
+ private:
+  static bool mapCached(const QString& path, quint64 hash, Layout* out) {
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) return false;
+    uchar* data = file->map(0, file->size());
+    if (!data) return false;
+
+    // The mapping lives as long as any copy of the layout.
+    std::shared_ptr<const void> keepAlive(data, [file](const void* p) {
+      file->unmap(const_cast<uchar*>(static_cast<const uchar*>(p)));
+    });
+
+    Layout layout;
+    if (!Layout::fromBinary(reinterpret_cast<const char*>(data),
+                            size_t(file->size()), keepAlive, &layout) ||
+        layout.sourceHash() != hash)
+      return false;
+    *out = layout;
+    return true;
+  }
+
+  static void writeCache(const QString& path, const Layout& layout) {
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) return;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(layout.data(), qint64(layout.byteSize()));
+    file.commit();
+  }
+
+  QString m_cacheDir;
+  bool m_lastCached = false;
+};
+
+#endif  // LAYOUTLOADER_HPP
@@ -1,10 +1,22 @@
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
+#include <QStandardPaths>
 
 #include "board.hpp"
+#include "dealdatabase.hpp"
+#include "replaylog.hpp"
+#include "solutioncache.hpp"
+#include "solverservice.hpp"
+#include "startup.hpp"
+#include "telemetry.hpp"
 #include "tile.hpp"
 #include "tilemodel.hpp"
+#include "winestimator.hpp"
 
 /**
  * @file main.cpp
@@ -12,22 +24,81 @@
  *
  * This file sets up the QGuiApplication and QQmlApplicationEngine,
  * registers the Tile class, creates and initializes the Board and TileModel,
- * and exposes them to QML. It then loads the main QML file, starting
- * the event loop for the application. This is where the game begins execution.
+ * and exposes them to QML. The first game is prepared and the tile images
+ * decoded while the main QML file loads (see StartupPipeline), then
+ * the event loop starts. This is where the game begins execution.
  */
 
 int main(int argc, char *argv[]) {
+  StartupPipeline startup;
   QGuiApplication app(argc, argv);
 
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  QCommandLineOption dealsOpt(
+      "deals", "Deal new games from a pre-generated deal database.", "file");
+  parser.addOption(dealsOpt);
+  QCommandLineOption newGameOpt("new", "Start a new game instead of resuming.");
+  parser.addOption(newGameOpt);
+  QCommandLineOption telemetryOpt(
+      "telemetry",
+      "Write gameplay events as NDJSON to a file or to unix:<socket>.",
+      "target");
+  parser.addOption(telemetryOpt);
+  QCommandLineOption randomShufflesOpt(
+      "random-shuffles",
+      "Shuffle at random instead of always leaving a solvable position.");
+  parser.addOption(randomShufflesOpt);
+  parser.process(app);
+
   qmlRegisterType<Tile>("Mahjong", 1, 0, "Tile");
+  qmlRegisterUncreatableType<SolverService>(
+      "Mahjong", 1, 0, "SolverService", "Use the solverService property");
 
+  DealDatabase deals;
+  ReplayWriter replay;
+  TelemetrySink telemetry;
+  WinEstimator winEstimator;
+  SolutionCache solutions;
   TileModel tileModel;
   Board board(&tileModel);
-  board.generateTurtleLayout();  // Initialize the turtle layout
+  board.setWinEstimator(&winEstimator);
+  board.setSolvableShuffles(!parser.isSet(randomShufflesOpt));
+  SolverService solverService;
+  solverService.setBoard(&board);
+  if (parser.isSet(dealsOpt)) {
+    QString error;
+    if (deals.open(parser.value(dealsOpt), &error))
+      board.setDealDatabase(&deals);
+    else
+      qWarning() << "Ignoring deal database:" << error;
+  }
+  if (parser.isSet(telemetryOpt)) {
+    if (telemetry.open(parser.value(telemetryOpt)))
+      board.setTelemetry(&telemetry);
+    else
+      qWarning() << "Cannot open telemetry sink" << parser.value(telemetryOpt);
+  }
+
+  // Every game is appended to the replay log. Resume the autosaved game
+  // unless a new one was asked for or the last one was finished.
+  const QString dataDir =
+      QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  const QString autosave = dataDir + "/autosave.mjsv";
+  const bool haveDataDir = QDir().mkpath(dataDir);
+  if (haveDataDir && replay.open(dataDir + "/replay.mjrl"))
+    board.setReplayLog(&replay);
+  if (haveDataDir && solutions.open(dataDir + "/solutions.mjsc"))
+    solverService.setCache(&solutions);
 
   QQmlApplicationEngine engine;
+  auto* images = new TileImageProvider;
+  engine.addImageProvider("tiles", images);  // Takes ownership
+  startup.start(&board, images, autosave, parser.isSet(newGameOpt));
+
   engine.rootContext()->setContextProperty("tileModel", &tileModel);
   engine.rootContext()->setContextProperty("board", &board);
+  engine.rootContext()->setContextProperty("solverService", &solverService);
 
   const QUrl url(QStringLiteral("src/qml/main.qml"));
   QObject::connect(
@@ -37,6 +108,15 @@ int main(int argc, char *argv[]) {
       },
       Qt::QueuedConnection);
   engine.load(url);
+  if (!engine.rootObjects().isEmpty()) {
+    if (auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects()[0]))
+      startup.reportFirstFrame(window);
+  }
+
+  // The tiles reach the model in one reset, after QML is ready for them.
+  if (!startup.applyTo(&board, board.dealDatabase() != nullptr))
+    board.generateTurtleLayout();
+  if (haveDataDir) board.setAutosavePath(autosave);
 
   return app.exec();
 }
@@ -0,0 +1,138 @@
+#ifndef MEMORYREPORT_HPP
+#define MEMORYREPORT_HPP
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * @file memoryreport.hpp
+ * @brief Declares MemoryReport, a per-subsystem breakdown of memory use.
+ *
+ * Qt does not expose the size of its private object data, so the numbers
+ * for QObjects and signal connections are estimates based on the typical
+ * size of those structures in a 64-bit Qt 6 build. Image and sound sizes
+ * are computed from the resource headers: images as 32-bit pixels once
+ * decoded, sounds as the length of their PCM data.
+ */
+
+class MemoryReport {
+ public:
+  // Approximate sizes of Qt internals on 64-bit Qt 6.
+  static constexpr qint64 QObjectPrivateBytes = 120;
+  static constexpr qint64 ConnectionBytes = 88;
+  static constexpr qint64 ConnectionDataBytes = 48;
+  static constexpr qint64 ConnectionListBytes = 16;
+  static constexpr qint64 ArrayHeaderBytes = 16;
+
+  struct Entry {
+    QString name;
+    qint64 count;
+    qint64 bytes;
+  };
+
+  void add(const QString& name, qint64 count, qint64 bytes) {
+    m_entries.append({name, count, bytes});
+  }
+
+  const QVector<Entry>& entries() const { return m_entries; }
+
+  qint64 totalBytes() const {
+    qint64 total = 0;
+    for (const Entry& e : m_entries) total += e.bytes;
+    return total;
+  }
+
+  QString toText() const {
+    QString text = QString("%1 %2 %3\n")
+                       .arg("subsystem", -24)
+                       .arg("count", 8)
+                       .arg("bytes", 12);
+    for (const Entry& e : m_entries) {
+      text += QString("%1 %2 %3\n")
+                  .arg(e.name, -24)
+                  .arg(e.count, 8)
+                  .arg(e.bytes, 12);
+    }
+    text += QString("%1 %2 %3\n").arg("total", -24).arg("", 8).arg(
+        totalBytes(), 12);
+    return text;
+  }
+
+  // For QML: a list of {name, count, bytes} maps.
+  QVariantList toVariantList() const {
+    QVariantList list;
+    for (const Entry& e : m_entries) {
+      list.append(QVariantMap{
+          {"name", e.name}, {"count", e.count}, {"bytes", e.bytes}});
+    }
+    return list;
+  }
+
+  static qint64 stringBytes(const QString& s) {
+    return ArrayHeaderBytes + (s.size() + 1) * qint64(sizeof(QChar));
+  }
+
+  // Decoded size of every image below a resource directory.
+  static qint64 decodedImageBytes(const QString& dir, qint64* count) {
+    qint64 bytes = 0;
+    *count = 0;
+    for (const QFileInfo& info : QDir(dir).entryInfoList(QDir::Files)) {
+      QSize size = QImageReader(info.filePath()).size();
+      if (!size.isValid()) continue;
+      bytes += qint64(size.width()) * size.height() * 4;
+      ++*count;
+    }
+    return bytes;
+  }
+
+  // Size of the PCM data of every WAV file below a resource directory.
+  static qint64 soundBufferBytes(const QString& dir, qint64* count) {
+    qint64 bytes = 0;
+    *count = 0;
+    for (const QFileInfo& info : QDir(dir).entryInfoList(QDir::Files)) {
+      qint64 pcm = wavDataBytes(info.filePath());
+      if (pcm < 0) continue;
+      bytes += pcm;
+      ++*count;
+    }
+    return bytes;
+  }
+
+ private:
+  // Walks the RIFF chunks and returns the size of the "data" chunk.
+  static qint64 wavDataBytes(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return -1;
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    char riff[4], wave[4];
+    quint32 riffSize;
+    if (in.readRawData(riff, 4) != 4) return -1;
+    in >> riffSize;
+    if (in.readRawData(wave, 4) != 4) return -1;
+    if (qstrncmp(riff, "RIFF", 4) != 0 || qstrncmp(wave, "WAVE", 4) != 0)
+      return -1;
+
+    while (!in.atEnd()) {
+      char id[4];
+      quint32 size;
+      if (in.readRawData(id, 4) != 4) return -1;
+      in >> size;
+      if (qstrncmp(id, "data", 4) == 0) return size;
+      if (in.skipRawData(size + (size & 1)) < 0) return -1;
+    }
+    return -1;
+  }
+
+  QVector<Entry> m_entries;
+};
+
+#endif  // MEMORYREPORT_HPP
@@ -1,6 +1,7 @@
 import QtQuick 2.15
 import QtQuick.Window 2.15
 import QtQuick.Controls 2.15
+import Mahjong 1.0
 
 Window {
     visible: true
@@ -45,7 +46,7 @@ Window {
 
             Image {
                 anchors.centerIn: parent
-                source: "qrc:/images/" + tileImageName(model.type, model.value)
+                source: "image://tiles/" + tileImageName(model.type, model.value)
                 width: parent.width - 10
                 height: parent.height - 10
                 fillMode: Image.PreserveAspectFit
@@ -60,10 +61,157 @@ Window {
         }
     }
 
-    Button {
-        text: "Shuffle"
+    // Debug overlay with the memory report, toggled with F12
+    Shortcut {
+        sequence: "F12"
+        onActivated: {
+            memoryText.text = board.memoryReportText()
+            memoryOverlay.visible = !memoryOverlay.visible
+        }
+    }
+
+    Rectangle {
+        id: memoryOverlay
+        visible: false
+        z: 1000
+        anchors.top: parent.top
+        anchors.left: parent.left
+        anchors.margins: 10
+        width: memoryText.implicitWidth + 20
+        height: memoryText.implicitHeight + 20
+        color: "#e0000000"
+        radius: 5
+
+        Text {
+            id: memoryText
+            anchors.centerIn: parent
+            color: "white"
+            font.family: "monospace"
+        }
+    }
+
+    Shortcut {
+        sequence: StandardKey.Undo
+        onActivated: board.undo()
+    }
+
+    Shortcut {
+        sequence: StandardKey.Redo
+        onActivated: board.redo()
+    }
+
+    // Solver output; a change of the position cancels the search
+    Connections {
+        target: solverService
+        function onProgress(nodes, depth, bestLine) {
+            solverText.text = "Solving: " + nodes + " positions, best " +
+                              bestLine.length / 2 + " pairs"
+        }
+        function onFinished(status, nodes, solution) {
+            if (status === SolverService.Solvable)
+                solverText.text = "Solvable in " + solution.length / 2 + " pairs"
+            else if (status === SolverService.Unsolvable)
+                solverText.text = "Not solvable without a shuffle"
+            else
+                solverText.text = "Gave up after " + nodes + " positions"
+        }
+    }
+
+    Connections {
+        target: board
+        function onPositionChanged() { solverText.text = "" }
+    }
+
+    // Prompt to shuffle as soon as no pair can be removed
+    Connections {
+        target: board
+        function onNoMovesLeft() { stuckPrompt.visible = true }
+        function onAvailablePairsChanged() {
+            if (board.availablePairs > 0)
+                stuckPrompt.visible = false
+        }
+    }
+
+    Rectangle {
+        id: stuckPrompt
+        visible: false
+        z: 1000
+        anchors.centerIn: parent
+        width: stuckColumn.implicitWidth + 40
+        height: stuckColumn.implicitHeight + 40
+        color: "#e0000000"
+        radius: 5
+
+        Column {
+            id: stuckColumn
+            anchors.centerIn: parent
+            spacing: 10
+
+            Text {
+                anchors.horizontalCenter: parent.horizontalCenter
+                text: "No moves left"
+                color: "white"
+                font.pixelSize: 20
+            }
+
+            Row {
+                anchors.horizontalCenter: parent.horizontalCenter
+                spacing: 10
+
+                Button {
+                    text: "Shuffle"
+                    onClicked: board.shuffle()
+                }
+
+                Button {
+                    text: "Undo"
+                    enabled: board.canUndo
+                    onClicked: board.undo()
+                }
+            }
+        }
+    }
+
+    Row {
         anchors.bottom: parent.bottom
         anchors.horizontalCenter: parent.horizontalCenter
-        onClicked: board.shuffle()
+        spacing: 10
+
+        Button {
+            text: "Undo"
+            enabled: board.canUndo
+            onClicked: board.undo()
+        }
+
+        Button {
+            text: "Shuffle"
+            onClicked: board.shuffle()
+        }
+
+        Button {
+            text: "Redo"
+            enabled: board.canRedo
+            onClicked: board.redo()
+        }
+
+        Button {
+            text: solverService.busy ? "Stop" : "Solve"
+            onClicked: solverService.busy ? solverService.cancel()
+                                          : solverService.solve()
+        }
+
+        Text {
+            id: solverText
+            anchors.verticalCenter: parent.verticalCenter
+        }
+
+        // Chance that random play clears the board without a shuffle
+        Text {
+            anchors.verticalCenter: parent.verticalCenter
+            visible: board.winPlayouts > 0
+            text: "Win chance " + Math.round(board.winProbability * 100) +
+                  "% (" + Math.round(board.winProbabilityLow * 100) + "-" +
+                  Math.round(board.winProbabilityHigh * 100) + "%)"
+        }
     }
 }
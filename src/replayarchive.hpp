@@ -0,0 +1,285 @@
+#ifndef REPLAYARCHIVE_HPP
+#define REPLAYARCHIVE_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QSysInfo>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "replaylog.hpp"
+
+/**
+ * @file replayarchive.hpp
+ * @brief Compressed archive of many replays with a random-access index.
+ *
+ * Replay records (see replaylog.hpp) are grouped into blocks of whole games,
+ * about BlockRecords records each, and every block is compressed on its
+ * own. An index at the end of the file lists the blocks and, for every
+ * game, its id (the order in which it was added), its seed and where its
+ * records are:
+ *
+ *   Header      magic "MJRA", version, block count, game count, index offset
+ *   Blocks      compressed records, one after the other
+ *   BlockEntry  offset, compressed size, record count  (per block)
+ *   GameEntry   seed, block, first record, record count, flags  (per game)
+ *
+ * Pulling out one game decompresses only its block, and blocks can be
+ * decompressed on as many threads as needed. Integers are little-endian.
+ */
+
+namespace ArchiveFormat {
+
+constexpr uint32_t Magic = 0x41524a4d;  // "MJRA"
+constexpr uint32_t Version = 1;
+constexpr int BlockRecords = 4096;  // 64 KiB of records before compression
+
+static_assert(QSysInfo::ByteOrder == QSysInfo::LittleEndian,
+              "Replay archives are stored little-endian");
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t blockCount;
+  uint32_t reserved;
+  uint64_t gameCount;
+  uint64_t indexOffset;
+};
+
+struct BlockEntry {
+  uint64_t offset;
+  uint32_t compressedSize;
+  uint32_t recordCount;
+};
+
+static_assert(sizeof(Header) == 32 && sizeof(BlockEntry) == 16,
+              "Archive layout changed");
+
+enum GameFlags : uint32_t { Seeded = 1 };
+
+struct GameEntry {
+  uint64_t seed;  // Valid if flags has Seeded
+  uint32_t block;
+  uint32_t firstRecord;  // Within the block
+  uint32_t recordCount;
+  uint32_t flags;
+};
+
+static_assert(sizeof(GameEntry) == 24, "Archive layout changed");
+
+// Calls f(begin, end) for every game in a record sequence. A game starts
+// at a NewGame record; records before the first one are skipped.
+template <typename F>
+void forEachGame(const ReplayFormat::Record* begin,
+                 const ReplayFormat::Record* end, F f) {
+  const ReplayFormat::Record* game = begin;
+  while (game != end && game->type != ReplayFormat::NewGame) ++game;
+  while (game != end) {
+    const ReplayFormat::Record* next = game + 1;
+    while (next != end && next->type != ReplayFormat::NewGame) ++next;
+    f(game, next);
+    game = next;
+  }
+}
+
+}  // namespace ArchiveFormat
+
+class ReplayArchiveWriter {
+ public:
+  bool open(const QString& path) {
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    m_blocks.clear();
+    m_games.clear();
+    m_pending.clear();
+    ArchiveFormat::Header header = {};
+    return write(&header, sizeof header);
+  }
+
+  // Adds one game, starting with its NewGame record.
+  bool addGame(const ReplayFormat::Record* records, int count) {
+    if (!m_pending.empty() &&
+        m_pending.size() + size_t(count) >
+            size_t(ArchiveFormat::BlockRecords) &&
+        !flushBlock())
+      return false;
+
+    ArchiveFormat::GameEntry game = {0, uint32_t(m_blocks.size()),
+                                     uint32_t(m_pending.size()),
+                                     uint32_t(count), 0};
+    if (count > 1 && records[1].type == ReplayFormat::Seed) {
+      game.seed = records[1].value;
+      game.flags = ArchiveFormat::Seeded;
+    }
+    m_games.push_back(game);
+    m_pending.insert(m_pending.end(), records, records + count);
+    return true;
+  }
+
+  // Adds every game of a replay log held in memory.
+  bool addLog(const ReplayFormat::Record* begin,
+              const ReplayFormat::Record* end) {
+    bool ok = true;
+    ArchiveFormat::forEachGame(
+        begin, end,
+        [&](const ReplayFormat::Record* game, const ReplayFormat::Record* e) {
+          ok = ok && addGame(game, int(e - game));
+        });
+    return ok;
+  }
+
+  qint64 gameCount() const { return qint64(m_games.size()); }
+
+  // Writes the last block, the index and the final header.
+  bool finish() {
+    if (!m_pending.empty() && !flushBlock()) return false;
+    ArchiveFormat::Header header = {ArchiveFormat::Magic,
+                                    ArchiveFormat::Version,
+                                    uint32_t(m_blocks.size()),
+                                    0,
+                                    uint64_t(m_games.size()),
+                                    uint64_t(m_file.pos())};
+    bool ok = write(m_blocks.data(),
+                    m_blocks.size() * sizeof(ArchiveFormat::BlockEntry)) &&
+              write(m_games.data(),
+                    m_games.size() * sizeof(ArchiveFormat::GameEntry)) &&
+              m_file.seek(0) && write(&header, sizeof header);
+    m_file.close();
+    return ok;
+  }
+
+ private:
+  bool flushBlock() {
+    const QByteArray compressed = qCompress(
+        reinterpret_cast<const uchar*>(m_pending.data()),
+        int(m_pending.size() * sizeof(ReplayFormat::Record)));
+    m_blocks.push_back({uint64_t(m_file.pos()), uint32_t(compressed.size()),
+                        uint32_t(m_pending.size())});
+    m_pending.clear();
+    return write(compressed.constData(), size_t(compressed.size()));
+  }
+
+  bool write(const void* data, size_t bytes) {
+    return m_file.write(static_cast<const char*>(data), qint64(bytes)) ==
+           qint64(bytes);
+  }
+
+  QFile m_file;
+  std::vector<ArchiveFormat::BlockEntry> m_blocks;
+  std::vector<ArchiveFormat::GameEntry> m_games;
+  std::vector<ReplayFormat::Record> m_pending;
+};
+
+/**
+ * Reads an archive through a memory mapping. After open() all methods are
+ * const and may be called from several threads at once.
+ */
+class ReplayArchive {
+ public:
+  bool open(const QString& path, QString* error = nullptr) {
+    auto fail = [error](const QString& message) {
+      if (error) *error = message;
+      return false;
+    };
+
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly))
+      return fail(QString("Cannot open %1").arg(path));
+    const uint64_t size = uint64_t(file->size());
+    if (size < sizeof(ArchiveFormat::Header)) return fail("File too small");
+    const uchar* data = file->map(0, file->size());
+    if (!data) return fail("Cannot map file");
+
+    ArchiveFormat::Header header;
+    std::memcpy(&header, data, sizeof header);
+    if (header.magic != ArchiveFormat::Magic ||
+        header.version != ArchiveFormat::Version)
+      return fail("Not a replay archive");
+    if (header.gameCount > size / sizeof(ArchiveFormat::GameEntry))
+      return fail("Bad game count");
+    const uint64_t indexBytes =
+        header.blockCount * sizeof(ArchiveFormat::BlockEntry) +
+        header.gameCount * sizeof(ArchiveFormat::GameEntry);
+    if (header.indexOffset > size || size - header.indexOffset < indexBytes)
+      return fail("Truncated index");
+
+    const uchar* index = data + header.indexOffset;
+    std::vector<ArchiveFormat::BlockEntry> blocks(header.blockCount);
+    std::memcpy(blocks.data(), index,
+                blocks.size() * sizeof(ArchiveFormat::BlockEntry));
+    std::vector<ArchiveFormat::GameEntry> games(header.gameCount);
+    std::memcpy(games.data(),
+                index + blocks.size() * sizeof(ArchiveFormat::BlockEntry),
+                games.size() * sizeof(ArchiveFormat::GameEntry));
+
+    for (const ArchiveFormat::BlockEntry& b : blocks) {
+      if (b.offset > header.indexOffset ||
+          header.indexOffset - b.offset < b.compressedSize)
+        return fail("Bad block entry");
+    }
+    for (const ArchiveFormat::GameEntry& g : games) {
+      if (g.block >= blocks.size() ||
+          uint64_t(g.firstRecord) + g.recordCount >
+              blocks[g.block].recordCount)
+        return fail("Bad game entry");
+    }
+
+    m_bySeed.clear();
+    for (size_t i = 0; i < games.size(); ++i) {
+      if (games[i].flags & ArchiveFormat::Seeded)
+        m_bySeed.emplace(games[i].seed, qint64(i));
+    }
+    m_blocks = std::move(blocks);
+    m_games = std::move(games);
+    m_data = data;
+    m_file = file;
+    return true;
+  }
+
+  qint64 gameCount() const { return qint64(m_games.size()); }
+  int blockCount() const { return int(m_blocks.size()); }
+  const ArchiveFormat::GameEntry& game(qint64 id) const { return m_games[id]; }
+  const ArchiveFormat::BlockEntry& block(int i) const { return m_blocks[i]; }
+
+  // Id of the first game dealt from a seed, or -1.
+  qint64 findSeed(uint64_t seed) const {
+    auto it = m_bySeed.find(seed);
+    return it == m_bySeed.end() ? -1 : it->second;
+  }
+
+  // Decompresses one block; empty if it is corrupt.
+  std::vector<ReplayFormat::Record> blockRecords(int i) const {
+    const ArchiveFormat::BlockEntry& b = m_blocks[i];
+    const QByteArray bytes =
+        qUncompress(m_data + b.offset, int(b.compressedSize));
+    std::vector<ReplayFormat::Record> records;
+    if (size_t(bytes.size()) != b.recordCount * sizeof(ReplayFormat::Record))
+      return records;
+    records.resize(b.recordCount);
+    std::memcpy(records.data(), bytes.constData(), size_t(bytes.size()));
+    return records;
+  }
+
+  // The records of one game; only its block is decompressed.
+  std::vector<ReplayFormat::Record> gameRecords(qint64 id) const {
+    const ArchiveFormat::GameEntry& g = m_games[id];
+    const std::vector<ReplayFormat::Record> block = blockRecords(int(g.block));
+    if (block.empty()) return block;
+    return std::vector<ReplayFormat::Record>(
+        block.begin() + g.firstRecord,
+        block.begin() + g.firstRecord + g.recordCount);
+  }
+
+ private:
+  std::shared_ptr<QFile> m_file;  // Unmaps on destruction
+  const uchar* m_data = nullptr;
+  std::vector<ArchiveFormat::BlockEntry> m_blocks;
+  std::vector<ArchiveFormat::GameEntry> m_games;
+  std::unordered_map<uint64_t, qint64> m_bySeed;
+};
+
+#endif  // REPLAYARCHIVE_HPP
@@ -0,0 +1,341 @@
+#ifndef REPLAYLOG_HPP
+#define REPLAYLOG_HPP
+
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QSysInfo>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+#include "undohistory.hpp"
+
+/**
+ * @file replaylog.hpp
+ * @brief Append-only log of everything that happens on a Board.
+ *
+ * A replay log is a 16-byte file header followed by 16-byte records:
+ *
+ *   NewGame   a = slot count, value = layout fingerprint
+ *   Seed      value = seed; the deal Board makes for that seed
+ *   Kinds     a = first slot, arg = count (up to 8), value = packed kinds;
+ *             together with RngWord describes a position that did not come
+ *             from a seed (a database deal or a restored save)
+ *   RngWord   arg = word index, value = generator state word
+ *   Select    a = slot of the first selected tile
+ *   Match     a, value = the two slots removed
+ *   Mismatch  a, value = the two slots that did not match
+ *   Shuffle   arg = 1 if the generator was reseeded with value first
+ *   SolvableShuffle
+ *             as Shuffle, with BoardState::solvableShuffle()
+ *   Undo      the last match or shuffle was taken back (see UndoHistory)
+ *   Redo      the last undone step was applied again
+ *
+ * The log therefore replays a game exactly from its seed: Replayer applies
+ * records to a BoardState without any Qt objects, millions per second.
+ * ReplayWriter appends records from the UI thread into a buffer that a
+ * background thread writes out, so moves never wait for the disk.
+ */
+
+static_assert(QSysInfo::ByteOrder == QSysInfo::LittleEndian,
+              "Replay logs are read in place as little-endian data");
+
+namespace ReplayFormat {
+
+constexpr uint32_t Magic = 0x4c524a4d;  // "MJRL"
+constexpr uint32_t Version = 1;
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t reserved;
+};
+
+enum Type : uint8_t {
+  NewGame = 1,
+  Seed,
+  Kinds,
+  RngWord,
+  Select,
+  Match,
+  Mismatch,
+  Shuffle,
+  Undo,
+  Redo,
+  SolvableShuffle
+};
+
+struct Record {
+  uint8_t type;
+  uint8_t arg;
+  uint16_t reserved;
+  uint32_t a;
+  uint64_t value;
+};
+
+static_assert(sizeof(FileHeader) == 16 && sizeof(Record) == 16,
+              "Replay records are 16 bytes");
+
+inline Record make(Type type, uint32_t a = 0, uint64_t value = 0,
+                   uint8_t arg = 0) {
+  return {type, arg, 0, a, value};
+}
+
+// The records describing a position: its kinds and the generator state.
+template <typename F>
+void forEachPositionRecord(const BoardState& state, const Rng::State& rng,
+                           F f) {
+  for (int first = 0; first < state.size(); first += 8) {
+    const int count = std::min(8, state.size() - first);
+    uint64_t packed = 0;
+    std::memcpy(&packed, state.kinds().data() + first, size_t(count));
+    f(make(Kinds, uint32_t(first), packed, uint8_t(count)));
+  }
+  for (int i = 0; i < 4; ++i) f(make(RngWord, 0, rng.s[i], uint8_t(i)));
+}
+
+}  // namespace ReplayFormat
+
+/**
+ * Replays records onto a BoardState. The layout must be given since the
+ * log only identifies it by fingerprint.
+ */
+class Replayer {
+ public:
+  explicit Replayer(const Layout& layout)
+      : m_layout(layout), m_fingerprint(layout.fingerprint()) {}
+
+  const BoardState& state() const { return m_state; }
+  const Rng& rng() const { return m_rng; }
+  int selected() const { return m_selected; }
+  int64_t games() const { return m_games; }
+  int64_t moves() const { return m_moves; }
+
+  // Applies one record. Returns false if it does not fit the game so far,
+  // for example a match of tiles that are not open.
+  bool apply(const ReplayFormat::Record& r) {
+    using namespace ReplayFormat;
+    if (r.type != NewGame && !m_started) return false;
+    switch (r.type) {
+      case NewGame:
+        if (r.value != m_fingerprint || int(r.a) != m_layout.size())
+          return false;
+        m_state = BoardState(m_layout);
+        m_history.clear();
+        m_selected = -1;
+        m_started = true;
+        ++m_games;
+        return true;
+      case Seed:
+        m_rng.reseed(r.value);
+        m_state.deal(m_rng);
+        return true;
+      case Kinds: {
+        if (r.arg > 8 || uint64_t(r.a) + r.arg > uint64_t(m_state.size()))
+          return false;
+        uint8_t kinds[8];
+        std::memcpy(kinds, &r.value, sizeof kinds);
+        for (int i = 0; i < r.arg; ++i) {
+          if (kinds[i] >= TileKind::Count && kinds[i] != TileKind::None)
+            return false;
+          m_state.set(int(r.a) + i, kinds[i]);
+        }
+        return true;
+      }
+      case RngWord: {
+        if (r.arg >= 4) return false;
+        Rng::State s = m_rng.state();
+        s.s[r.arg] = r.value;
+        m_rng.setState(s);
+        return true;
+      }
+      case Select:
+        if (!validSlot(r.a) || !m_state.occupied(int(r.a))) return false;
+        m_selected = int(r.a);
+        return true;
+      case Match:
+        if (!validSlot(r.a) || !validSlot(r.value) ||
+            !m_state.canRemove(int(r.a), int(r.value)))
+          return false;
+        m_history.pushPair(m_state, int(r.a), int(r.value));
+        m_state.removePair(int(r.a), int(r.value));
+        m_selected = -1;
+        ++m_moves;
+        return true;
+      case Mismatch:
+        m_selected = -1;
+        return true;
+      case Shuffle:
+      case SolvableShuffle: {
+        if (r.arg) m_rng.reseed(r.value);
+        std::vector<int32_t> permutation;
+        if (r.type == SolvableShuffle)
+          m_state.solvableShuffle(m_rng, &permutation);
+        else
+          m_state.shuffle(m_rng, &permutation);
+        m_history.pushShuffle(std::move(permutation));
+        m_selected = -1;
+        return true;
+      }
+      case Undo:
+        m_selected = -1;
+        return m_history.undo(m_state) != nullptr;
+      case Redo:
+        m_selected = -1;
+        return m_history.redo(m_state) != nullptr;
+      default:
+        return false;
+    }
+  }
+
+  // Applies records until one fails; returns how many were applied.
+  int64_t apply(const ReplayFormat::Record* begin,
+                const ReplayFormat::Record* end) {
+    const ReplayFormat::Record* r = begin;
+    while (r != end && apply(*r)) ++r;
+    return r - begin;
+  }
+
+ private:
+  bool validSlot(uint64_t slot) const {
+    return slot < uint64_t(m_state.size());
+  }
+
+  Layout m_layout;
+  uint64_t m_fingerprint;
+  BoardState m_state;
+  UndoHistory m_history;
+  Rng m_rng;
+  int m_selected = -1;
+  bool m_started = false;
+  int64_t m_games = 0;
+  int64_t m_moves = 0;
+};
+
+/**
+ * Appends records to a replay log file. append() only copies the record
+ * into a buffer; a writer thread takes the whole buffer at once and writes
+ * it out, at the latest FlushIntervalMs after the record was added.
+ */
+class ReplayWriter {
+ public:
+  static constexpr int FlushIntervalMs = 250;
+
+  ~ReplayWriter() { close(); }
+
+  // Opens a log for appending, creating it if needed.
+  bool open(const QString& path) {
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) return false;
+
+    ReplayFormat::FileHeader header = {ReplayFormat::Magic,
+                                       ReplayFormat::Version, 0};
+    if (m_file.size() == 0) {
+      m_file.write(reinterpret_cast<const char*>(&header), sizeof header);
+    } else {
+      ReplayFormat::FileHeader existing;
+      if (m_file.read(reinterpret_cast<char*>(&existing), sizeof existing) !=
+              qint64(sizeof existing) ||
+          existing.magic != header.magic ||
+          existing.version != header.version) {
+        m_file.close();
+        return false;
+      }
+      // Drop a record cut short by a crash.
+      const qint64 records =
+          (m_file.size() - qint64(sizeof header)) / qint64(sizeof(Record));
+      if (!m_file.resize(qint64(sizeof header) +
+                         records * qint64(sizeof(Record)))) {
+        m_file.close();
+        return false;
+      }
+      m_file.seek(m_file.size());
+    }
+
+    m_stop = false;
+    m_thread.reset(QThread::create([this] { run(); }));
+    m_thread->start();
+    return true;
+  }
+
+  bool isOpen() const { return m_thread != nullptr; }
+
+  // Records appended while no log is open are dropped.
+  void append(const ReplayFormat::Record& record) {
+    QMutexLocker lock(&m_mutex);
+    if (!m_thread) return;
+    m_pending.push_back(record);
+  }
+
+  // Writes everything appended so far and waits until it is in the file.
+  void flush() {
+    QMutexLocker lock(&m_mutex);
+    if (!m_thread) return;
+    m_flushRequested = true;
+    m_wake.wakeOne();
+    while (m_flushRequested) m_flushed.wait(&m_mutex);
+  }
+
+  void close() {
+    if (!m_thread) return;
+    {
+      QMutexLocker lock(&m_mutex);
+      m_stop = true;
+      m_wake.wakeOne();
+    }
+    m_thread->wait();
+    m_thread.reset();
+    m_file.close();
+  }
+
+ private:
+  using Record = ReplayFormat::Record;
+
+  void run() {
+    std::vector<Record> batch;
+    QMutexLocker lock(&m_mutex);
+    for (;;) {
+      if (!m_stop && !m_flushRequested)
+        m_wake.wait(&m_mutex, FlushIntervalMs);
+      batch.swap(m_pending);
+      const bool stop = m_stop;
+      const bool flushRequested = m_flushRequested;
+
+      lock.unlock();
+      if (!batch.empty()) {
+        m_file.write(reinterpret_cast<const char*>(batch.data()),
+                     qint64(batch.size() * sizeof(Record)));
+        m_file.flush();
+        batch.clear();
+      }
+      lock.relock();
+
+      if (flushRequested) {
+        m_flushRequested = false;
+        m_flushed.wakeAll();
+      }
+      if (stop && m_pending.empty()) return;
+    }
+  }
+
+  QFile m_file;  // Only used by the writer thread while it runs
+  QMutex m_mutex;
+  QWaitCondition m_wake;
+  QWaitCondition m_flushed;
+  std::vector<Record> m_pending;
+  bool m_stop = false;
+  bool m_flushRequested = false;
+  std::unique_ptr<QThread> m_thread;
+};
+
+#endif  // REPLAYLOG_HPP
@@ -0,0 +1,98 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <utility>
+
+/**
+ * @file rng.hpp
+ * @brief Declares Rng, the seedable random number generator of the engine.
+ *
+ * Rng implements xoshiro256** seeded through splitmix64. It is small, fast
+ * and, unlike std::shuffle with std::mt19937, its shuffle() is fully
+ * specified here, so the same seed produces the same deal on every platform
+ * and standard library. All randomness used by the Board goes through one
+ * instance; saving its state() is enough to continue a game exactly.
+ */
+
+class Rng {
+ public:
+  using result_type = uint64_t;
+
+  struct State {
+    uint64_t s[4];
+  };
+
+  explicit Rng(uint64_t seed = 0) { reseed(seed); }
+
+  // Seed from the operating system, for games that do not ask for one.
+  static uint64_t randomSeed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+  }
+
+  void reseed(uint64_t seed) {
+    uint64_t x = seed;
+    for (uint64_t& word : m_state.s) word = splitmix64(x);
+  }
+
+  State state() const { return m_state; }
+  void setState(const State& state) { m_state = state; }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  result_type operator()() {
+    uint64_t* s = m_state.s;
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // Uniform integer in [0, bound) without modulo bias (Lemire's method).
+  uint32_t bounded(uint32_t bound) {
+    uint64_t m = uint64_t(uint32_t((*this)() >> 32)) * bound;
+    uint32_t low = uint32_t(m);
+    if (low < bound) {
+      uint32_t threshold = uint32_t(-bound) % bound;
+      while (low < threshold) {
+        m = uint64_t(uint32_t((*this)() >> 32)) * bound;
+        low = uint32_t(m);
+      }
+    }
+    return uint32_t(m >> 32);
+  }
+
+  // Fisher-Yates shuffle with a platform independent result.
+  template <typename RandomIt>
+  void shuffle(RandomIt first, RandomIt last) {
+    auto n = std::distance(first, last);
+    for (auto i = n - 1; i > 0; --i) {
+      auto j = bounded(static_cast<uint32_t>(i + 1));
+      using std::swap;
+      swap(first[i], first[j]);
+    }
+  }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  static uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  State m_state;
+};
+
+#endif  // RNG_HPP
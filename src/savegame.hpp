@@ -0,0 +1,216 @@
+#ifndef SAVEGAME_HPP
+#define SAVEGAME_HPP
+
+#include <QByteArray>
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QString>
+#include <QSysInfo>
+#include <QThread>
+#include <QWaitCondition>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "rng.hpp"
+#include "tilekind.hpp"
+
+/**
+ * @file savegame.hpp
+ * @brief Binary snapshot of a game in progress.
+ *
+ * A save is a fixed 80-byte header followed by one tile kind per layout
+ * slot (TileKind::None for removed tiles), so a turtle game takes 224
+ * bytes and is written with two memcpy calls:
+ *
+ *   magic "MJSV", version, slot count, selected slot (-1 for none),
+ *   layout fingerprint (see Layout::fingerprint()), seed, deal index,
+ *   generator state, kinds
+ *
+ * The layout itself is not stored; a save can only be restored onto the
+ * layout with the same fingerprint. Integers are little-endian like the
+ * deal database.
+ *
+ * AutosaveWriter keeps such a file up to date from a thread of its own.
+ * Saves handed to it within DelayMs of each other are coalesced and only
+ * the newest is written, so the UI thread never waits for the file system
+ * and a quick series of moves costs one atomic replace (QSaveFile).
+ */
+
+static_assert(QSysInfo::ByteOrder == QSysInfo::LittleEndian,
+              "Save files are read in place as little-endian data");
+
+namespace SaveGame {
+
+constexpr uint32_t Magic = 0x56534a4d;  // "MJSV"
+constexpr uint32_t Version = 1;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  int32_t selectedSlot;
+  uint64_t layoutFingerprint;
+  uint64_t seed;
+  int64_t dealIndex;
+  uint64_t reserved;
+  Rng::State rng;
+};
+
+static_assert(sizeof(Header) == 80, "Save header layout changed");
+
+struct Snapshot {
+  uint64_t layoutFingerprint = 0;
+  int selectedSlot = -1;
+  uint64_t seed = 0;
+  int64_t dealIndex = -1;
+  Rng::State rng = {};
+  std::vector<uint8_t> kinds;
+};
+
+inline QByteArray write(const Snapshot& snapshot) {
+  const Header header = {Magic,
+                         Version,
+                         uint32_t(snapshot.kinds.size()),
+                         int32_t(snapshot.selectedSlot),
+                         snapshot.layoutFingerprint,
+                         snapshot.seed,
+                         snapshot.dealIndex,
+                         0,
+                         snapshot.rng};
+  QByteArray bytes(qsizetype(sizeof header + snapshot.kinds.size()),
+                   Qt::Uninitialized);
+  std::memcpy(bytes.data(), &header, sizeof header);
+  std::memcpy(bytes.data() + sizeof header, snapshot.kinds.data(),
+              snapshot.kinds.size());
+  return bytes;
+}
+
+// Returns false if the bytes are not a complete save of this version or
+// hold kinds the game does not know.
+inline bool read(const QByteArray& bytes, Snapshot* out) {
+  Header header;
+  if (size_t(bytes.size()) < sizeof header) return false;
+  std::memcpy(&header, bytes.constData(), sizeof header);
+  if (header.magic != Magic || header.version != Version) return false;
+  if (size_t(bytes.size()) != sizeof header + header.slotCount) return false;
+  if (header.selectedSlot < -1 ||
+      header.selectedSlot >= int64_t(header.slotCount))
+    return false;
+
+  const uint8_t* kinds =
+      reinterpret_cast<const uint8_t*>(bytes.constData()) + sizeof header;
+  for (uint32_t i = 0; i < header.slotCount; ++i) {
+    if (kinds[i] >= TileKind::Count && kinds[i] != TileKind::None)
+      return false;
+  }
+
+  out->layoutFingerprint = header.layoutFingerprint;
+  out->selectedSlot = header.selectedSlot;
+  out->seed = header.seed;
+  out->dealIndex = header.dealIndex;
+  out->rng = header.rng;
+  out->kinds.assign(kinds, kinds + header.slotCount);
+  return true;
+}
+
+}  // namespace SaveGame
+
+class AutosaveWriter {
+ public:
+  static constexpr int DelayMs = 500;
+
+  ~AutosaveWriter() { close(); }
+
+  // Starts writing saves to the file; an empty path stops.
+  void open(const QString& path) {
+    close();
+    if (path.isEmpty()) return;
+    m_path = path;
+    m_stop = false;
+    m_thread.reset(QThread::create([this] { run(); }));
+    m_thread->start();
+  }
+
+  bool isOpen() const { return m_thread != nullptr; }
+  QString path() const { return m_path; }
+
+  // Replaces the save waiting to be written, if any.
+  void save(const QByteArray& bytes) {
+    QMutexLocker lock(&m_mutex);
+    if (!m_thread) return;
+    m_pending = bytes;
+    // While a save is waiting the writer is in its delay; waking it would
+    // end the delay early.
+    if (!m_hasPending) m_wake.wakeOne();
+    m_hasPending = true;
+  }
+
+  // Writes the waiting save now and waits until it is in the file.
+  void flush() {
+    QMutexLocker lock(&m_mutex);
+    if (!m_thread) return;
+    m_flushRequested = true;
+    m_wake.wakeOne();
+    while (m_flushRequested) m_flushed.wait(&m_mutex);
+  }
+
+  // Writes the waiting save and stops.
+  void close() {
+    if (!m_thread) return;
+    {
+      QMutexLocker lock(&m_mutex);
+      m_stop = true;
+      m_wake.wakeOne();
+    }
+    m_thread->wait();
+    m_thread.reset();
+    m_path.clear();
+  }
+
+ private:
+  void run() {
+    QMutexLocker lock(&m_mutex);
+    for (;;) {
+      while (!m_stop && !m_flushRequested && !m_hasPending)
+        m_wake.wait(&m_mutex);
+      // Give the next moves a chance to replace this save.
+      if (!m_stop && !m_flushRequested) m_wake.wait(&m_mutex, DelayMs);
+      const QByteArray bytes = m_pending;
+      const bool write = m_hasPending;
+      m_hasPending = false;
+      const bool stop = m_stop;
+      const bool flushRequested = m_flushRequested;
+
+      lock.unlock();
+      if (write) {
+        QSaveFile file(m_path);
+        if (!file.open(QIODevice::WriteOnly) ||
+            file.write(bytes) != bytes.size() || !file.commit())
+          qWarning() << "Cannot write autosave" << m_path;
+      }
+      lock.relock();
+
+      if (flushRequested) {
+        m_flushRequested = false;
+        m_flushed.wakeAll();
+      }
+      if (stop && !m_hasPending) return;
+    }
+  }
+
+  QString m_path;  // Set while the thread is not running
+  QMutex m_mutex;
+  QWaitCondition m_wake;
+  QWaitCondition m_flushed;
+  QByteArray m_pending;
+  bool m_hasPending = false;
+  bool m_stop = false;
+  bool m_flushRequested = false;
+  std::unique_ptr<QThread> m_thread;
+};
+
+#endif  // SAVEGAME_HPP
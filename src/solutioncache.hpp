@@ -0,0 +1,284 @@
+#ifndef SOLUTIONCACHE_HPP
+#define SOLUTIONCACHE_HPP
+
+#include <QCache>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QSysInfo>
+#include <cstdint>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "solver.hpp"
+#include "tilekind.hpp"
+
+/**
+ * @file solutioncache.hpp
+ * @brief Solver results of known positions, kept on disk.
+ *
+ * Positions are keyed by a canonical hash: the layout fingerprint and the
+ * match class of every slot, so deals that differ only in which season or
+ * flower sits where (the solver cannot tell them apart) share one entry.
+ * The file is append-only:
+ *
+ *   Header  magic "MJSC", version
+ *   Record  key, layout fingerprint, status (Solver::Status), solution
+ *           length in pairs, slot count, followed by the match class of
+ *           every slot and the solution as pairs of 32-bit slots
+ *
+ * open() reads the record headers into an index from key to file offset
+ * and drops a torn record at the end; a later record for a key replaces
+ * an earlier one. The most recently used entries are also kept in memory
+ * (a QCache), so repeated lookups do not touch the disk. Only decided
+ * results are stored. An entry is only returned if its fingerprint and
+ * match classes are those of the position, so a hash collision is a
+ * miss, and insert() then stores the position over it. A cached solution
+ * is also replayed, so a damaged record is not trusted either. Caches of
+ * an older version are started afresh.
+ */
+
+static_assert(QSysInfo::ByteOrder == QSysInfo::LittleEndian,
+              "Solution caches are read as little-endian data");
+
+namespace SolutionCacheFormat {
+
+constexpr uint32_t Magic = 0x43534a4d;  // "MJSC"
+constexpr uint32_t Version = 2;  // 2: fingerprint and match classes
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct Record {
+  uint64_t key;
+  uint64_t fingerprint;
+  uint8_t status;
+  uint8_t reserved;
+  uint16_t length;  // Pairs that follow the match classes
+  uint32_t slots;  // Match classes that follow
+};
+
+static_assert(sizeof(Record) == 24 && sizeof(Move) == 8,
+              "Solution records are 24 bytes plus 1 per slot and 8 per "
+              "pair");
+
+}  // namespace SolutionCacheFormat
+
+class SolutionCache {
+ public:
+  static constexpr int DefaultMemoryEntries = 1024;
+
+  struct Stats {
+    int64_t memoryHits = 0;
+    int64_t diskHits = 0;
+    int64_t misses = 0;
+  };
+
+  SolutionCache() : m_memory(DefaultMemoryEntries) {}
+
+  // The canonical hash of a position, see the file comment.
+  static uint64_t key(const BoardState& state) {
+    return key(state.layout().fingerprint(), classes(state));
+  }
+
+  // Opens or creates a cache file.
+  bool open(const QString& path, QString* error = nullptr) {
+    using namespace SolutionCacheFormat;
+    auto fail = [this, error](const QString& message) {
+      if (error) *error = message;
+      m_file.close();
+      return false;
+    };
+    m_file.close();
+    m_index.clear();
+    m_memory.clear();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite))
+      return fail("Cannot open " + path);
+
+    Header header;
+    if (m_file.size() == 0) {
+      header = {Magic, Version};
+      if (m_file.write(reinterpret_cast<const char*>(&header),
+                       sizeof header) != sizeof header)
+        return fail("Cannot write " + path);
+      return true;
+    }
+    if (m_file.read(reinterpret_cast<char*>(&header), sizeof header) !=
+            sizeof header ||
+        header.magic != Magic)
+      return fail(path + " is not a solution cache");
+    if (header.version < Version) {
+      header = {Magic, Version};
+      if (!m_file.resize(0) || !m_file.seek(0) ||
+          m_file.write(reinterpret_cast<const char*>(&header),
+                       sizeof header) != sizeof header)
+        return fail("Cannot write " + path);
+      return true;
+    }
+    if (header.version != Version)
+      return fail(path + ": unsupported version " +
+                  QString::number(header.version));
+
+    qint64 offset = sizeof header;
+    Record r;
+    while (m_file.read(reinterpret_cast<char*>(&r), sizeof r) == sizeof r) {
+      const qint64 end = offset + qint64(sizeof r) + qint64(r.slots) +
+                         qint64(r.length) * qint64(sizeof(Move));
+      if (end > m_file.size()) break;
+      m_index.insert(r.key, offset);
+      offset = end;
+      m_file.seek(offset);
+    }
+    if (offset < m_file.size()) m_file.resize(offset);  // Torn last record
+    return true;
+  }
+
+  bool isOpen() const { return m_file.isOpen(); }
+  qint64 count() const { return m_index.size(); }
+  const Stats& stats() const { return m_stats; }
+
+  // Entries kept in memory besides the file.
+  void setMemoryEntries(int count) { m_memory.setMaxCost(count); }
+
+  // Fills status and solution of the result if the position is known.
+  bool find(const BoardState& state, Solver::Result* result) {
+    const std::vector<uint8_t> c = classes(state);
+    const uint64_t k = key(state.layout().fingerprint(), c);
+    Entry entry;
+    const Entry* cached = m_memory.object(k);
+    if (cached) {
+      entry = *cached;
+    } else if (!read(k, &entry)) {
+      m_stats.misses++;
+      return false;
+    }
+    if (!holds(entry, state, c)) {
+      m_stats.misses++;  // A colliding position
+      return false;
+    }
+    if (cached) {
+      m_stats.memoryHits++;
+    } else {
+      m_stats.diskHits++;
+      m_memory.insert(k, new Entry(entry));
+    }
+    result->status = entry.status;
+    result->nodes = 0;
+    result->solution = std::move(entry.solution);
+    return true;
+  }
+
+  // Stores a decided result; returns false if it is not stored. An entry
+  // of a colliding position under the same key is superseded.
+  bool insert(const BoardState& state, const Solver::Result& result) {
+    using namespace SolutionCacheFormat;
+    if (!isOpen() || result.status == Solver::Status::Unknown ||
+        result.solution.size() > UINT16_MAX)
+      return false;
+    const uint64_t fingerprint = state.layout().fingerprint();
+    const std::vector<uint8_t> c = classes(state);
+    const uint64_t k = key(fingerprint, c);
+    Entry known;
+    if (read(k, &known) && holds(known, state, c)) return false;
+
+    const Record r = {k,
+                      fingerprint,
+                      uint8_t(result.status),
+                      0,
+                      uint16_t(result.solution.size()),
+                      uint32_t(c.size())};
+    const qint64 offset = m_file.size();
+    const qint64 bytes = qint64(result.solution.size() * sizeof(Move));
+    if (!m_file.seek(offset) ||
+        m_file.write(reinterpret_cast<const char*>(&r), sizeof r) !=
+            sizeof r ||
+        m_file.write(reinterpret_cast<const char*>(c.data()),
+                     qint64(c.size())) != qint64(c.size()) ||
+        m_file.write(reinterpret_cast<const char*>(result.solution.data()),
+                     bytes) != bytes) {
+      m_file.resize(offset);
+      return false;
+    }
+    m_file.flush();
+    m_index.insert(k, offset);
+    m_memory.insert(k, new Entry{result.status, fingerprint, c,
+                                 result.solution});
+    return true;
+  }
+
+ private:
+  struct Entry {
+    Solver::Status status = Solver::Status::Unknown;
+    uint64_t fingerprint = 0;
+    std::vector<uint8_t> classes;
+    std::vector<Move> solution;
+  };
+
+  // The match class of every slot, TileKind::None for empty ones.
+  static std::vector<uint8_t> classes(const BoardState& state) {
+    std::vector<uint8_t> c(static_cast<size_t>(state.size()));
+    for (int s = 0; s < state.size(); ++s)
+      c[size_t(s)] = state.occupied(s)
+                         ? uint8_t(TileKind::matchClass(state.kind(s)))
+                         : uint8_t(TileKind::None);
+    return c;
+  }
+
+  static uint64_t key(uint64_t fingerprint, const std::vector<uint8_t>& c) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto add = [&h](uint8_t byte) {
+      h ^= byte;
+      h *= 0x100000001b3ULL;
+    };
+    for (int b = 0; b < 8; ++b) add(uint8_t(fingerprint >> (8 * b)));
+    for (uint8_t byte : c) add(byte);
+    return h;
+  }
+
+  // True if the entry was stored for the position.
+  static bool holds(const Entry& entry, const BoardState& state,
+                    const std::vector<uint8_t>& c) {
+    return entry.fingerprint == state.layout().fingerprint() &&
+           entry.classes == c &&
+           (entry.status != Solver::Status::Solvable ||
+            plays(state, entry.solution));
+  }
+
+  bool read(uint64_t k, Entry* entry) {
+    using namespace SolutionCacheFormat;
+    const auto it = m_index.constFind(k);
+    if (it == m_index.constEnd()) return false;
+    Record r;
+    if (!m_file.seek(it.value()) ||
+        m_file.read(reinterpret_cast<char*>(&r), sizeof r) != sizeof r ||
+        r.status >= uint8_t(Solver::Status::Unknown))
+      return false;
+    entry->status = Solver::Status(r.status);
+    entry->fingerprint = r.fingerprint;
+    entry->classes.resize(r.slots);
+    entry->solution.resize(r.length);
+    const qint64 bytes = qint64(r.length) * qint64(sizeof(Move));
+    return m_file.read(reinterpret_cast<char*>(entry->classes.data()),
+                       qint64(r.slots)) == qint64(r.slots) &&
+           m_file.read(reinterpret_cast<char*>(entry->solution.data()),
+                       bytes) == bytes;
+  }
+
+  static bool plays(BoardState state, const std::vector<Move>& solution) {
+    for (const Move& m : solution) {
+      if (!state.canRemove(m.first, m.second)) return false;
+      state.removePair(m.first, m.second);
+    }
+    return state.isCleared();
+  }
+
+  QFile m_file;
+  QHash<quint64, qint64> m_index;  // Key to record offset
+  QCache<quint64, Entry> m_memory;
+  Stats m_stats;
+};
+
+#endif  // SOLUTIONCACHE_HPP
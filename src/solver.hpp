@@ -0,0 +1,317 @@
+#ifndef SOLVER_HPP
+#define SOLVER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "rng.hpp"
+#include "tilekind.hpp"
+#include "transpositiontable.hpp"
+
+/**
+ * @file solver.hpp
+ * @brief Exact solver: can a position be cleared without shuffling?
+ *
+ * Depth-first search over BoardState::appendMoves(), the move generator
+ * Board uses, so the solver plays by exactly the game rules. Positions
+ * proven dead are remembered by their Zobrist hash (one random word per
+ * slot, xor-ed over the occupied slots) in a TranspositionTable of fixed
+ * size, which collapses the many move orders that lead to the same
+ * position. The table is kept between solves.
+ *
+ * Two reductions shrink the tree further; both keep the answer exact, as
+ * removing tiles never closes a tile that was open:
+ *
+ * - Safe moves. When every remaining tile of a match class is open, one
+ *   of their pairs is the only move tried: any solution can be reordered
+ *   to remove it first. Tiles within a class are interchangeable, so this
+ *   is where the indistinguishable copies of a kind stop branching.
+ * - Sleep sets (partial-order reduction). After the subtree of a move m
+ *   failed, the siblings explored after it do not try m again as long as
+ *   they only remove other tiles: every such line is a reordering of one
+ *   below m.
+ *
+ * The moves of a position are tried in the order of Options::ordering,
+ * which changes how soon a solution is found but not the answer. On the
+ * hard deals of bench/hardseeds.txt taking pairs from long rows first
+ * solves the most; the other heuristics did not help, and LastPair only
+ * matters without safe moves (a class's last pair is then always safe).
+ * The search gives up with Status::Unknown after Options::nodeLimit
+ * nodes, or when cancelled.
+ */
+
+class Solver {
+ public:
+  enum class Status { Solvable, Unsolvable, Unknown };
+
+  // Move ordering heuristics, combined as flags. Earlier ones weigh more.
+  enum Ordering : unsigned {
+    LastPair = 1,  // Pairs that remove the last two tiles of a class
+    FreesTiles = 2,  // Pairs that open the most tiles
+    LongRows = 4,  // Pairs from the longest rows
+  };
+
+  // What a running search has found so far, see Options::progress.
+  struct Progress {
+    int64_t nodes;
+    int depth;  // Pairs removed in the position being searched
+    const std::vector<Move>* bestLine;  // Longest line found so far
+  };
+
+  struct Options {
+    int64_t nodeLimit = 1000000;
+    // Checked at every node; setting it from another thread stops the
+    // search with Status::Unknown.
+    const std::atomic<bool>* cancel = nullptr;
+    // Called from the searching thread every progressInterval nodes.
+    std::function<void(const Progress&)> progress;
+    int64_t progressInterval = 65536;
+    // Memory for dead positions; a full table evicts by the policy.
+    int64_t tableBytes = int64_t(16) << 20;
+    TranspositionTable::Replacement replacement =
+        TranspositionTable::Replacement::Work;
+    bool safeMoves = true;
+    bool sleepSets = true;
+    unsigned ordering = LongRows;  // Ordering flags
+  };
+
+  struct Result {
+    Status status = Status::Unknown;
+    int64_t nodes = 0;
+    std::vector<Move> solution;  // Pairs to remove in order, if solvable
+    TranspositionTable::Stats table;
+    // Nodes searched that had no pair left, and the pairs the nodes had
+    // before the reductions, which describe the shape of the tree.
+    int64_t deadEnds = 0;
+    int64_t pairs = 0;
+  };
+
+  Solver() = default;
+  explicit Solver(const Options& options) : m_options(options) {}
+
+  Result solve(const BoardState& state) {
+    m_state = state;
+    m_nodes = 0;
+    m_deadEnds = 0;
+    m_pairs = 0;
+    m_aborted = false;
+    if (!m_table)
+      m_table.reset(
+          new TranspositionTable(m_options.tableBytes, m_options.replacement));
+    m_table->newSearch();
+    m_path.clear();
+    m_bestLine.clear();
+    m_moves.assign(size_t(state.remaining() / 2 + 1), {});
+    m_sleep.assign(m_moves.size(), {});
+    m_remainingPerClass.fill(0);
+    for (int s = 0; s < state.size(); ++s) {
+      if (state.occupied(s))
+        m_remainingPerClass[TileKind::matchClass(state.kind(s))]++;
+    }
+
+    m_zobrist.resize(size_t(state.size()));
+    Rng rng(0x5a0b7157);
+    for (uint64_t& z : m_zobrist) z = rng();
+    m_hash = 0;
+    for (int s = 0; s < state.size(); ++s) {
+      if (state.occupied(s)) m_hash ^= m_zobrist[s];
+    }
+
+    Result result;
+    const bool solved = search(0);
+    result.nodes = m_nodes;
+    result.table = m_table->stats();
+    result.deadEnds = m_deadEnds;
+    result.pairs = m_pairs;
+    if (solved) {
+      result.status = Status::Solvable;
+      result.solution = m_path;
+    } else {
+      result.status = m_aborted ? Status::Unknown : Status::Unsolvable;
+    }
+    return result;
+  }
+
+ private:
+  bool search(size_t depth) {
+    if (m_state.isCleared()) return true;
+    if (m_table->contains(m_hash)) return false;
+    const int64_t first = m_nodes;
+    if (++m_nodes > m_options.nodeLimit ||
+        (m_options.cancel &&
+         m_options.cancel->load(std::memory_order_relaxed))) {
+      m_aborted = true;
+      return false;
+    }
+    if (m_options.progress) {
+      if (m_path.size() > m_bestLine.size()) m_bestLine = m_path;
+      if (m_nodes % m_options.progressInterval == 0)
+        m_options.progress({m_nodes, int(depth), &m_bestLine});
+    }
+
+    std::vector<Move>& moves = m_moves[depth];
+    moves.clear();
+    m_state.appendMoves(&moves);
+    m_pairs += int64_t(moves.size());
+    if (moves.empty()) m_deadEnds++;
+    if (m_options.safeMoves) keepSafeMove(&moves);
+    if (m_options.ordering) orderMoves(&moves);
+    std::vector<Move>& sleep = m_sleep[depth];
+    const size_t asleep = sleep.size();  // Given by the parent
+    for (const Move& m : moves) {
+      if (std::any_of(sleep.begin(), sleep.begin() + asleep,
+                      [&m](const Move& s) { return same(s, m); }))
+        continue;
+      if (m_options.sleepSets) {
+        // The child sleeps on what this node sleeps on and on the siblings
+        // tried so far, unless m removes one of their tiles.
+        std::vector<Move>& childSleep = m_sleep[depth + 1];
+        childSleep.clear();
+        for (const Move& s : sleep) {
+          if (disjoint(s, m)) childSleep.push_back(s);
+        }
+      }
+      const int firstKind = m_state.kind(m.first);
+      const int secondKind = m_state.kind(m.second);
+      m_remainingPerClass[TileKind::matchClass(firstKind)] -= 2;
+      m_state.removePair(m.first, m.second);
+      m_hash ^= m_zobrist[m.first] ^ m_zobrist[m.second];
+      m_path.push_back(m);
+
+      if (search(depth + 1)) return true;
+
+      m_path.pop_back();
+      m_hash ^= m_zobrist[m.first] ^ m_zobrist[m.second];
+      m_state.set(m.first, firstKind);
+      m_state.set(m.second, secondKind);
+      m_remainingPerClass[TileKind::matchClass(firstKind)] += 2;
+      if (m_aborted) return false;
+      if (m_options.sleepSets) sleep.push_back(m);
+    }
+
+    m_table->insert(m_hash, m_nodes - first);
+    return false;
+  }
+
+  // Reduces the moves, grouped by class as Moves::append() makes them, to
+  // a single pair of a class whose remaining tiles are all open.
+  void keepSafeMove(std::vector<Move>* moves) const {
+    for (size_t g = 0; g < moves->size();) {
+      // The group of a class with n open tiles starts with n - 1 pairs of
+      // its first open tile.
+      const Move first = (*moves)[g];
+      size_t n = 1;
+      while (g + n - 1 < moves->size() &&
+             (*moves)[g + n - 1].first == first.first)
+        ++n;
+      const int cls = TileKind::matchClass(m_state.kind(first.first));
+      if (int(n) == m_remainingPerClass[cls]) {
+        moves->assign(1, first);
+        return;
+      }
+      g += n * (n - 1) / 2;
+    }
+  }
+
+  // Sorts the moves by the ordering heuristics, best first.
+  void orderMoves(std::vector<Move>* moves) {
+    if (moves->size() < 2) return;
+    m_scored.clear();
+    for (const Move& m : *moves) m_scored.push_back({score(m), m});
+    std::stable_sort(m_scored.begin(), m_scored.end(),
+                     [](const Scored& a, const Scored& b) {
+                       return a.score > b.score;
+                     });
+    for (size_t i = 0; i < moves->size(); ++i)
+      (*moves)[i] = m_scored[i].move;
+  }
+
+  int score(const Move& m) {
+    const unsigned ordering = m_options.ordering;
+    int score = 0;
+    if (ordering & LastPair) {
+      const int cls = TileKind::matchClass(m_state.kind(m.first));
+      if (m_remainingPerClass[cls] == 2) score += 1 << 20;
+    }
+    if (ordering & FreesTiles) score += freedBy(m) << 10;
+    if (ordering & LongRows) score += rowLength(m.first) + rowLength(m.second);
+    return score;
+  }
+
+  // Tiles that are closed now and open once the pair is removed.
+  int freedBy(const Move& m) {
+    m_closed.clear();
+    auto collect = [this, &m](int s) {
+      if (m_state.occupied(s) && s != m.first && s != m.second &&
+          !m_state.isOpen(s) &&
+          std::find(m_closed.begin(), m_closed.end(), s) == m_closed.end())
+        m_closed.push_back(s);
+    };
+    m_state.layout().forEachAffected(m.first, collect);
+    m_state.layout().forEachAffected(m.second, collect);
+    if (m_closed.empty()) return 0;
+
+    const int firstKind = m_state.kind(m.first);
+    const int secondKind = m_state.kind(m.second);
+    m_state.removePair(m.first, m.second);
+    const int freed = int(std::count_if(
+        m_closed.begin(), m_closed.end(),
+        [this](int32_t s) { return m_state.isOpen(s); }));
+    m_state.set(m.first, firstKind);
+    m_state.set(m.second, secondKind);
+    return freed;
+  }
+
+  // Occupied slots in the row the slot is in, counting through neighbours.
+  int rowLength(int slot) const {
+    const Layout& layout = m_state.layout();
+    int length = 1;
+    for (int s = layout.left(slot); s >= 0 && m_state.occupied(s);
+         s = layout.left(s))
+      ++length;
+    for (int s = layout.right(slot); s >= 0 && m_state.occupied(s);
+         s = layout.right(s))
+      ++length;
+    return length;
+  }
+
+  static bool same(const Move& a, const Move& b) {
+    return a.first == b.first && a.second == b.second;
+  }
+
+  static bool disjoint(const Move& a, const Move& b) {
+    return a.first != b.first && a.first != b.second &&
+           a.second != b.first && a.second != b.second;
+  }
+
+  Options m_options;
+  BoardState m_state;
+  int64_t m_nodes = 0;
+  int64_t m_deadEnds = 0;
+  int64_t m_pairs = 0;
+  bool m_aborted = false;
+  uint64_t m_hash = 0;
+  std::vector<uint64_t> m_zobrist;
+  std::unique_ptr<TranspositionTable> m_table;  // Dead positions
+  std::vector<Move> m_path;
+  std::vector<Move> m_bestLine;  // Only kept for progress reports
+  std::vector<std::vector<Move>> m_moves;  // Move list per depth
+  std::vector<std::vector<Move>> m_sleep;  // Sleep set per depth
+  std::array<int, TileKind::Count> m_remainingPerClass;
+
+  // Scratch space of orderMoves()
+  struct Scored {
+    int score;
+    Move move;
+  };
+  std::vector<Scored> m_scored;
+  std::vector<int32_t> m_closed;
+};
+
+#endif  // SOLVER_HPP
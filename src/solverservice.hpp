@@ -0,0 +1,187 @@
+#ifndef SOLVERSERVICE_HPP
+#define SOLVERSERVICE_HPP
+
+#include <QList>
+#include <QMetaObject>
+#include <QObject>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "board.hpp"
+#include "boardstate.hpp"
+#include "solutioncache.hpp"
+#include "solver.hpp"
+
+/**
+ * @file solverservice.hpp
+ * @brief Solves positions on a thread pool without blocking the UI.
+ *
+ * solve() copies the position and starts a Solver on the service's pool.
+ * Progress and the result come back as queued signals. Each request gets
+ * a generation number: a new request, cancel(), or a change of the
+ * attached board's position (a match, shuffle, undo, redo or new game)
+ * bumps it and sets the running search's cancel flag, and anything the
+ * worker posts for an older generation is dropped before it is emitted.
+ * The UI thread never waits for a search, except in the destructor.
+ *
+ * With a SolutionCache attached, known positions are answered from it
+ * without a search (still through the queued finished signal), and every
+ * decided result is added to it.
+ *
+ * Lines are reported as flat lists of slots, two per pair, which QML can
+ * use directly.
+ */
+
+class SolverService : public QObject {
+  Q_OBJECT
+  Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+ public:
+  enum Status { Solvable, Unsolvable, Unknown };
+  Q_ENUM(Status)
+
+  static constexpr int64_t DefaultNodeLimit = 20000000;
+
+  explicit SolverService(QObject* parent = nullptr) : QObject(parent) {}
+
+  ~SolverService() override {
+    cancel();
+    m_pool.waitForDone();
+  }
+
+  // Positions of the board are solved by solve(); changes of its position
+  // cancel the search. The board must outlive the service or be detached.
+  void setBoard(Board* board) {
+    if (m_board) disconnect(m_board, nullptr, this, nullptr);
+    m_board = board;
+    if (m_board)
+      connect(m_board, &Board::positionChanged, this, &SolverService::cancel);
+  }
+  Board* board() const { return m_board; }
+
+  // The cache is only used from the service's thread. It must outlive the
+  // service or be detached.
+  void setCache(SolutionCache* cache) { m_cache = cache; }
+  SolutionCache* cache() const { return m_cache; }
+
+  int64_t nodeLimit() const { return m_nodeLimit; }
+  void setNodeLimit(int64_t limit) { m_nodeLimit = limit; }
+
+  // Nodes between two progress signals.
+  int64_t progressInterval() const { return m_progressInterval; }
+  void setProgressInterval(int64_t nodes) { m_progressInterval = nodes; }
+
+  bool busy() const { return m_busy; }
+
+  // Solves the attached board's position.
+  Q_INVOKABLE void solve() {
+    if (m_board) solve(m_board->state());
+  }
+
+  // Starts solving a position; a search still running is cancelled.
+  void solve(const BoardState& state) {
+    stop();
+    auto job = std::make_shared<Job>();
+    job->generation = m_generation;
+    m_job = job;
+    setBusy(true);
+
+    Solver::Result known;
+    if (m_cache && m_cache->find(state, &known)) {
+      post(job->generation, [this, known] { finish(known); });
+      return;
+    }
+
+    Solver::Options options;
+    options.nodeLimit = m_nodeLimit;
+    options.cancel = &job->cancel;
+    options.progressInterval = m_progressInterval;
+    options.progress = [this, job](const Solver::Progress& p) {
+      const QList<int> line = slotList(*p.bestLine);
+      const qint64 nodes = p.nodes;
+      const int depth = p.depth;
+      post(job->generation, [this, nodes, depth, line] {
+        emit progress(nodes, depth, line);
+      });
+    };
+    m_pool.start([this, job, options, state] {
+      Solver solver(options);
+      const Solver::Result result = solver.solve(state);
+      post(job->generation, [this, state, result] {
+        if (m_cache) m_cache->insert(state, result);
+        finish(result);
+      });
+    });
+  }
+
+  // Stops the running search, if any; nothing more is emitted for it.
+  Q_INVOKABLE void cancel() {
+    stop();
+    setBusy(false);
+  }
+
+ signals:
+  void busyChanged();
+  // Pairs removed in the position being searched and the longest line
+  // found so far.
+  void progress(qint64 nodes, int depth, const QList<int>& bestLine);
+  void finished(SolverService::Status status, qint64 nodes,
+                const QList<int>& solution);
+
+ private:
+  struct Job {
+    uint64_t generation = 0;
+    std::atomic<bool> cancel{false};
+  };
+
+  void finish(const Solver::Result& result) {
+    m_job.reset();
+    setBusy(false);
+    emit finished(Status(int(result.status)), result.nodes,
+                  slotList(result.solution));
+  }
+
+  void stop() {
+    m_generation++;
+    if (m_job) {
+      m_job->cancel = true;
+      m_job.reset();
+    }
+  }
+
+  static QList<int> slotList(const std::vector<Move>& moves) {
+    QList<int> list;
+    list.reserve(qsizetype(moves.size()) * 2);
+    for (const Move& m : moves) list << m.first << m.second;
+    return list;
+  }
+
+  // Runs f in the service's thread unless the request is outdated by then.
+  template <typename F>
+  void post(uint64_t generation, F f) {
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, f] {
+          if (m_generation == generation) f();
+        },
+        Qt::QueuedConnection);
+  }
+
+  void setBusy(bool busy) {
+    if (m_busy == busy) return;
+    m_busy = busy;
+    emit busyChanged();
+  }
+
+  QThreadPool m_pool;
+  Board* m_board = nullptr;
+  SolutionCache* m_cache = nullptr;
+  std::shared_ptr<Job> m_job;  // The running request
+  std::atomic<uint64_t> m_generation{0};
+  int64_t m_nodeLimit = DefaultNodeLimit;
+  int64_t m_progressInterval = 65536;
+  bool m_busy = false;
+};
+
+#endif  // SOLVERSERVICE_HPP
@@ -0,0 +1,183 @@
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQuickImageProvider>
+#include <QQuickWindow>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <memory>
+
+#include "board.hpp"
+#include "boardstate.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+#include "savegame.hpp"
+
+/**
+ * @file startup.hpp
+ * @brief Overlapping game setup and asset decoding with QML loading.
+ *
+ * Before QML is loaded, StartupPipeline::start() hands the slow parts of
+ * startup to other threads: reading the autosave and dealing a fresh game
+ * on one worker, decoding every tile image on the thread pool, and
+ * decoding the sounds (QSoundEffect's own loader). The GUI thread
+ * meanwhile compiles and instantiates QML. Afterwards applyTo() starts the
+ * prepared game, which fills the model with a single reset, and the time
+ * to the first frame is reported.
+ */
+
+/**
+ * Serves the tile images as "image://tiles/<file>", decoded ahead of time
+ * by decodeAll(). A request for an image still being decoded waits for it.
+ */
+class TileImageProvider : public QQuickImageProvider {
+ public:
+  explicit TileImageProvider(const QString& dir = ":/images")
+      : QQuickImageProvider(QQuickImageProvider::Image), m_dir(dir) {}
+
+  // Starts decoding every image of the directory on the given pool.
+  void decodeAll(QThreadPool* pool) {
+    const QStringList files = QDir(m_dir).entryList(QDir::Files);
+    {
+      QMutexLocker lock(&m_mutex);
+      m_pending = int(files.size());
+    }
+    for (const QString& file : files) {
+      pool->start([this, file] {
+        QImage image(m_dir + "/" + file);
+        QMutexLocker lock(&m_mutex);
+        m_images.insert(file, image);
+        --m_pending;
+        m_decoded.wakeAll();
+      });
+    }
+  }
+
+  QImage requestImage(const QString& id, QSize* size,
+                      const QSize& requestedSize) override {
+    QImage image;
+    {
+      QMutexLocker lock(&m_mutex);
+      while (!m_images.contains(id) && m_pending > 0) m_decoded.wait(&m_mutex);
+      image = m_images.value(id);
+    }
+    if (image.isNull()) image = QImage(m_dir + "/" + id);  // Not preloaded
+    if (size) *size = image.size();
+    if (requestedSize.isValid() && !image.isNull())
+      image = image.scaled(requestedSize, Qt::KeepAspectRatio,
+                           Qt::SmoothTransformation);
+    return image;
+  }
+
+ private:
+  const QString m_dir;
+  QMutex m_mutex;
+  QWaitCondition m_decoded;
+  QHash<QString, QImage> m_images;
+  int m_pending = 0;
+};
+
+class StartupPipeline {
+ public:
+  StartupPipeline() { m_clock.start(); }
+  ~StartupPipeline() {
+    if (m_worker) m_worker->wait();
+  }
+
+  /**
+   * Starts preparing the first game and decoding assets. Unless newGame is
+   * set, the autosave at autosavePath is resumed if it holds a game in
+   * progress; otherwise a fresh turtle game is dealt from a random seed.
+   * The image provider is handed to the QML engine by the caller, which
+   * takes ownership of it.
+   */
+  void start(Board* board, TileImageProvider* images,
+             const QString& autosavePath, bool newGame) {
+    images->decodeAll(QThreadPool::globalInstance());
+    board->loadSounds();
+
+    m_worker.reset(QThread::create([this, autosavePath, newGame] {
+      QElapsedTimer timer;
+      timer.start();
+      if (!newGame) m_saved = readSave(autosavePath);
+      if (m_saved.isEmpty()) {
+        m_seed = Rng::randomSeed();
+        m_rng.reseed(m_seed);
+        m_dealt = BoardState(Layout::turtle());
+        m_dealt.deal(m_rng);
+      }
+      m_prepareMs = timer.nsecsElapsed() / 1e6;
+    }));
+    m_worker->start();
+  }
+
+  /**
+   * Waits for the prepared game and starts it on the board. Returns false
+   * if the caller should deal a game itself: when the autosave does not
+   * restore, or when there is no autosave to resume and preferDatabase is
+   * set (new games come from a deal database then).
+   */
+  bool applyTo(Board* board, bool preferDatabase) {
+    m_worker->wait();
+    m_qmlMs = m_clock.nsecsElapsed() / 1e6;
+    if (!m_saved.isEmpty()) return board->restoreState(m_saved);
+    if (preferDatabase) return false;
+    board->startDealt(std::move(m_dealt), m_seed, m_rng);
+    return true;
+  }
+
+  // Logs the time from construction to the first frame of the window. The
+  // window may render on its own thread.
+  void reportFirstFrame(QQuickWindow* window) {
+    QObject::connect(
+        window, &QQuickWindow::frameSwapped, window,
+        [this] {
+          if (m_reported) return;
+          m_reported = true;
+          qInfo().nospace() << "First frame after "
+                            << m_clock.nsecsElapsed() / 1000000 << " ms"
+                            << " (game ready after " << m_prepareMs
+                            << " ms on a worker, QML loaded after "
+                            << m_qmlMs << " ms)";
+        },
+        Qt::DirectConnection);
+  }
+
+ private:
+  // The autosave if it holds a game that is not finished, else empty.
+  static QByteArray readSave(const QString& path) {
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) return {};
+    const QByteArray bytes = file.readAll();
+    SaveGame::Snapshot snapshot;
+    if (!SaveGame::read(bytes, &snapshot)) return {};
+    for (uint8_t kind : snapshot.kinds) {
+      if (kind != TileKind::None) return bytes;
+    }
+    return {};
+  }
+
+  QElapsedTimer m_clock;
+  std::unique_ptr<QThread> m_worker;
+
+  // Written by the worker, read after it finished.
+  QByteArray m_saved;
+  BoardState m_dealt;
+  quint64 m_seed = 0;
+  Rng m_rng;
+  double m_prepareMs = 0;
+
+  double m_qmlMs = 0;
+  bool m_reported = false;
+};
+
+#endif  // STARTUP_HPP
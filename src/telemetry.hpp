@@ -0,0 +1,228 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QLocalSocket>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @file telemetry.hpp
+ * @brief Optional NDJSON stream of gameplay events and engine timings.
+ *
+ * Board posts a TelemetryEvent for every game start, move, shuffle, undo,
+ * redo and game end. post() only copies the event into a lock-free
+ * single-producer ring; a writer thread formats the events as one JSON
+ * object per line and writes them to a file or a local (UNIX domain)
+ * socket. When the ring is full the event is dropped and counted, so the
+ * UI thread never waits for the sink.
+ *
+ *   {"event":"move","time":1718000000000,"seed":42,"first":12,
+ *    "second":40,"match":true,"remaining":142,"micros":17}
+ */
+
+struct TelemetryEvent {
+  enum Type : uint8_t { GameStart, Move, Shuffle, Undo, Redo, GameEnd };
+  enum Result : uint8_t { Won, Abandoned };
+
+  int64_t time;  // Milliseconds since the epoch
+  uint64_t seed;
+  int64_t micros;  // Engine time spent on the event
+  int32_t first;  // Move: slots; GameStart: slot count
+  int32_t second;
+  int32_t remaining;  // Tiles left after the event
+  Type type;
+  uint8_t flag;  // Move: matched; GameEnd: Result
+
+  static TelemetryEvent make(Type type, uint64_t seed, int remaining,
+                             int64_t micros = 0, int first = -1,
+                             int second = -1, uint8_t flag = 0) {
+    return {QDateTime::currentMSecsSinceEpoch(), seed, micros, first, second,
+            remaining, type, flag};
+  }
+
+  QByteArray toJson() const {
+    static const char* const names[] = {"start", "move", "shuffle",
+                                        "undo",  "redo", "end"};
+    QByteArray line = "{\"event\":\"";
+    line += names[type];
+    line += "\",\"time\":" + QByteArray::number(qint64(time)) +
+            ",\"seed\":" + QByteArray::number(quint64(seed));
+    switch (type) {
+      case GameStart:
+        line += ",\"slots\":" + QByteArray::number(first);
+        break;
+      case Move:
+        line += ",\"first\":" + QByteArray::number(first) +
+                ",\"second\":" + QByteArray::number(second) +
+                ",\"match\":" + (flag ? "true" : "false");
+        break;
+      case GameEnd:
+        line += ",\"result\":";
+        line += flag == Won ? "\"won\"" : "\"abandoned\"";
+        break;
+      default:
+        break;
+    }
+    line += ",\"remaining\":" + QByteArray::number(remaining) +
+            ",\"micros\":" + QByteArray::number(qint64(micros)) + "}\n";
+    return line;
+  }
+};
+
+/**
+ * Bounded queue for one producer thread and one consumer thread. push()
+ * and pop() never block and never allocate.
+ */
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+      : m_capacity(capacity), m_items(new T[capacity]) {}
+
+  // False if the queue is full.
+  bool push(const T& item) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == m_capacity)
+      return false;
+    m_items[head % m_capacity] = item;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // False if the queue is empty.
+  bool pop(T* item) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) return false;
+    *item = m_items[tail % m_capacity];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  const size_t m_capacity;
+  std::unique_ptr<T[]> m_items;
+  alignas(64) std::atomic<size_t> m_head{0};  // Written by the producer
+  alignas(64) std::atomic<size_t> m_tail{0};  // Written by the consumer
+};
+
+/**
+ * Writes telemetry events from one producer thread (the one Board lives
+ * in) to a file or a local socket. The writer thread wakes every
+ * PollIntervalMs and writes whatever has been posted since.
+ */
+class TelemetrySink {
+ public:
+  static constexpr int Capacity = 4096;
+  static constexpr int PollIntervalMs = 50;
+
+  TelemetrySink() : m_queue(Capacity) {}
+  ~TelemetrySink() { close(); }
+
+  /**
+   * Opens a sink. A target of the form "unix:<name>" connects to a local
+   * socket (a path, or a name as understood by QLocalSocket) and
+   * reconnects when the listener goes away; events posted while it is
+   * gone are dropped. Any other target is a file that events are appended
+   * to.
+   */
+  bool open(const QString& target) {
+    close();
+    m_socketName.clear();
+    if (target.startsWith("unix:")) {
+      m_socketName = target.mid(5);
+      if (m_socketName.isEmpty()) return false;
+    } else {
+      m_file.setFileName(target);
+      // Batches go straight to the file, so a failed write shows at once.
+      if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append |
+                       QIODevice::Unbuffered))
+        return false;
+    }
+    m_stop = false;
+    m_thread.reset(QThread::create([this] { run(); }));
+    m_thread->start();
+    return true;
+  }
+
+  bool isOpen() const { return m_thread != nullptr; }
+
+  // Called from the producer thread only.
+  void post(const TelemetryEvent& event) {
+    if (!m_queue.push(event)) m_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Events lost to a full queue, a missing socket listener or a failed
+  // file write.
+  qint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+  // Writes what is still queued and stops the writer thread.
+  void close() {
+    if (!m_thread) return;
+    m_stop = true;
+    m_thread->wait();
+    m_thread.reset();
+    m_file.close();
+  }
+
+ private:
+  void run() {
+    // The socket lives in the writer thread; it only uses blocking calls.
+    std::unique_ptr<QLocalSocket> socket;
+    if (!m_socketName.isEmpty()) socket.reset(new QLocalSocket);
+
+    QByteArray batch;
+    for (;;) {
+      const bool stop = m_stop;
+      TelemetryEvent event;
+      qint64 events = 0;
+      while (m_queue.pop(&event)) {
+        batch += event.toJson();
+        ++events;
+      }
+      if (events > 0) {
+        if (socket) {
+          if (!writeSocket(socket.get(), batch))
+            m_dropped.fetch_add(events, std::memory_order_relaxed);
+        } else if (!writeFile(batch)) {
+          m_dropped.fetch_add(events, std::memory_order_relaxed);
+        }
+        batch.clear();
+      }
+      if (stop) break;
+      QThread::msleep(PollIntervalMs);
+    }
+    if (socket) socket->disconnectFromServer();
+  }
+
+  bool writeFile(const QByteArray& bytes) {
+    return m_file.write(bytes) == bytes.size();
+  }
+
+  bool writeSocket(QLocalSocket* socket, const QByteArray& bytes) {
+    if (socket->state() != QLocalSocket::ConnectedState) {
+      socket->abort();
+      socket->connectToServer(m_socketName, QIODevice::WriteOnly);
+      if (!socket->waitForConnected(PollIntervalMs)) return false;
+    }
+    if (socket->write(bytes) != bytes.size()) return false;
+    while (socket->bytesToWrite() > 0) {
+      if (!socket->waitForBytesWritten(1000)) return false;
+    }
+    return true;
+  }
+
+  SpscQueue<TelemetryEvent> m_queue;
+  std::atomic<qint64> m_dropped{0};
+  std::atomic<bool> m_stop{false};
+  QString m_socketName;  // Set for socket sinks
+  QFile m_file;  // Only used by the writer thread while it runs
+  std::unique_ptr<QThread> m_thread;
+};
+
+#endif  // TELEMETRY_HPP
@@ -94,6 +94,19 @@ class Tile : public QObject {
     }
   }
 
+  // Number of connections to the property change signals. Used by the
+  // memory report; a tile held by a TileModel has eight.
+  int connectionCount() const {
+    return receivers(SIGNAL(typeChanged())) +
+           receivers(SIGNAL(valueChanged())) +
+           receivers(SIGNAL(faceUpChanged())) +
+           receivers(SIGNAL(rowChanged())) +
+           receivers(SIGNAL(columnChanged())) +
+           receivers(SIGNAL(selectedChanged())) +
+           receivers(SIGNAL(openChanged())) +
+           receivers(SIGNAL(layerChanged()));
+  }
+
   int layer() const { return m_layer; }
   void setLayer(int l) {
     if (m_layer != l) {
@@ -0,0 +1,116 @@
+#ifndef TILEKIND_HPP
+#define TILEKIND_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @file tilekind.hpp
+ * @brief Compact numbering of tile faces and the deck built from them.
+ *
+ * Every face used by the game gets a small integer id ("kind"): the nine
+ * Bamboo and nine Circle values, the fifteen Pinyin values, the four seasons
+ * and the four flowers. Kinds are what the engine stores per slot; the Tile
+ * objects shown in QML still carry the type name and value.
+ *
+ * Seasons match any season and flowers match any flower, so matching is
+ * defined on match classes rather than on kinds.
+ */
+
+namespace TileKind {
+
+enum : uint8_t {
+  FirstBamboo = 0,
+  FirstCircle = 9,
+  FirstPinyin = 18,
+  FirstSeason = 33,
+  FirstFlower = 37,
+  Count = 41,
+  None = 0xFF
+};
+
+inline const char* typeName(int kind) {
+  static const char* const specials[] = {"Spring", "Summer",  "Fall",
+                                         "Winter", "Chrysanthemum",
+                                         "Lotus",  "Orchid",  "Peony"};
+  if (kind < FirstCircle) return "Bamboo";
+  if (kind < FirstPinyin) return "Circle";
+  if (kind < FirstSeason) return "Pinyin";
+  return specials[kind - FirstSeason];
+}
+
+inline int value(int kind) {
+  if (kind < FirstCircle) return kind - FirstBamboo + 1;
+  if (kind < FirstPinyin) return kind - FirstCircle + 1;
+  if (kind < FirstSeason) return kind - FirstPinyin + 1;
+  return 1;
+}
+
+// Returns the kind for a face, or None if the face is unknown.
+inline int fromFace(const char* type, int value) {
+  if (std::strcmp(type, "Bamboo") == 0 && value >= 1 && value <= 9)
+    return FirstBamboo + value - 1;
+  if (std::strcmp(type, "Circle") == 0 && value >= 1 && value <= 9)
+    return FirstCircle + value - 1;
+  if (std::strcmp(type, "Pinyin") == 0 && value >= 1 && value <= 15)
+    return FirstPinyin + value - 1;
+  for (int k = FirstSeason; k < Count; ++k) {
+    if (std::strcmp(type, typeName(k)) == 0) return k;
+  }
+  return None;
+}
+
+// Seasons and flowers collapse into one class each; every other kind is
+// its own class.
+inline int matchClass(int kind) {
+  if (kind >= FirstFlower) return FirstFlower;
+  if (kind >= FirstSeason) return FirstSeason;
+  return kind;
+}
+
+inline bool matches(int a, int b) { return matchClass(a) == matchClass(b); }
+
+/**
+ * Builds an unshuffled deck for @p count slots (count must be even).
+ *
+ * Faces are dealt in identical pairs, alternating between the standard
+ * suits (Bamboo, Circle, Pinyin in order) and the specials (seasons and
+ * flowers in turn). Dealing pairs keeps every match class at an even count,
+ * so any layout size gets a proportional deck that can in principle be
+ * cleared.
+ */
+inline std::vector<uint8_t> deck(int count) {
+  std::vector<uint8_t> kinds;
+  kinds.reserve(count);
+
+  int standard = 0;
+  int season = 0;
+  int flower = 0;
+  bool useStandard = true;
+  bool useSeason = true;
+
+  for (int i = 0; i + 1 < count; i += 2) {
+    int kind;
+    if (useStandard) {
+      kind = standard;
+      standard = (standard + 1) % FirstSeason;
+    } else if (useSeason) {
+      kind = FirstSeason + season;
+      season = (season + 1) % 4;
+      useSeason = false;
+    } else {
+      kind = FirstFlower + flower;
+      flower = (flower + 1) % 4;
+      useSeason = true;
+    }
+    useStandard = !useStandard;
+    kinds.push_back(static_cast<uint8_t>(kind));
+    kinds.push_back(static_cast<uint8_t>(kind));
+  }
+  return kinds;
+}
+
+}  // namespace TileKind
+
+#endif  // TILEKIND_HPP
@@ -87,14 +87,7 @@ class TileModel : public QAbstractListModel {
     m_tiles.append(tile);
     endInsertRows();
 
-    connect(tile, &Tile::typeChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::valueChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::faceUpChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::rowChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::columnChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::selectedChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::openChanged, this, &TileModel::onTileChanged);
-    connect(tile, &Tile::layerChanged, this, &TileModel::onTileChanged);
+    connectTile(tile);
   }
 
   void clear() {
@@ -105,11 +98,23 @@ class TileModel : public QAbstractListModel {
     endRemoveRows();
   }
 
+  // Replaces all tiles with one model reset instead of a row insertion per
+  // tile. The model takes ownership of the new tiles.
+  void resetTiles(const QVector<Tile*>& tiles) {
+    beginResetModel();
+    qDeleteAll(m_tiles);
+    m_tiles = tiles;
+    for (Tile* t : m_tiles) connectTile(t);
+    endResetModel();
+  }
+
   QList<Tile*> takeAllTiles() {
     if (m_tiles.isEmpty()) return QList<Tile*>();
 
     beginRemoveRows(QModelIndex(), 0, m_tiles.size() - 1);
     QList<Tile*> all = m_tiles.toList();
+    // The tiles may be added again; addTile() reconnects them.
+    for (Tile* t : all) t->disconnect(this);
     m_tiles.clear();
     endRemoveRows();
 
@@ -145,6 +150,8 @@ class TileModel : public QAbstractListModel {
 
   QList<Tile*> allTiles() const { return m_tiles.toList(); }
 
+  qsizetype capacity() const { return m_tiles.capacity(); }
+
  private slots:
   void onTileChanged() {
     Tile* changedTile = qobject_cast<Tile*>(sender());
@@ -159,6 +166,17 @@ class TileModel : public QAbstractListModel {
   }
 
  private:
+  void connectTile(Tile* tile) {
+    connect(tile, &Tile::typeChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::valueChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::faceUpChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::rowChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::columnChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::selectedChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::openChanged, this, &TileModel::onTileChanged);
+    connect(tile, &Tile::layerChanged, this, &TileModel::onTileChanged);
+  }
+
   QVector<Tile*> m_tiles;
 };
 
@@ -0,0 +1,141 @@
+#ifndef TRANSPOSITIONTABLE_HPP
+#define TRANSPOSITIONTABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+/**
+ * @file transpositiontable.hpp
+ * @brief Fixed-size cache of positions a search has proven dead.
+ *
+ * The table is an array of 64-byte buckets, one cache line each, holding
+ * four entries: the full 64-bit position hash, the work spent proving the
+ * position (nodes, saturating), the search it belongs to and when it was
+ * stored. A hash only ever looks at its own bucket, so a probe touches a
+ * single cache line, and the memory use is fixed when the table is built.
+ *
+ * When a bucket is full a store has to evict an entry (a collision): with
+ * Replacement::Work the one that was cheapest to prove, which keeps the
+ * expensive subtrees (depth-preferred replacement, with the subtree size
+ * standing in for the depth), with Replacement::Age the one stored first.
+ * Entries of earlier searches count as empty, so starting a search does
+ * not need to clear the table.
+ */
+
+class TranspositionTable {
+ public:
+  enum class Replacement { Work, Age };
+
+  struct Stats {
+    int64_t probes = 0;
+    int64_t hits = 0;
+    int64_t stores = 0;
+    int64_t collisions = 0;  // Stores that evicted an entry of this search
+
+    int64_t misses() const { return probes - hits; }
+
+    Stats& operator+=(const Stats& other) {
+      probes += other.probes;
+      hits += other.hits;
+      stores += other.stores;
+      collisions += other.collisions;
+      return *this;
+    }
+  };
+
+  static constexpr int EntriesPerBucket = 4;
+
+  // A table of at most the given size, rounded down to a power of two
+  // buckets (at least one).
+  explicit TranspositionTable(int64_t bytes,
+                              Replacement replacement = Replacement::Work)
+      : m_replacement(replacement) {
+    size_t buckets = 1;
+    while (int64_t(buckets * 2 * sizeof(Bucket)) <= bytes) buckets *= 2;
+    m_buckets.reset(new Bucket[buckets]);
+    m_mask = buckets - 1;
+    clear();
+  }
+
+  int64_t byteSize() const { return int64_t(m_mask + 1) * sizeof(Bucket); }
+  int64_t capacity() const { return int64_t(m_mask + 1) * EntriesPerBucket; }
+  Replacement replacement() const { return m_replacement; }
+
+  // Forgets every entry by starting a new search; the statistics restart.
+  void newSearch() {
+    if (++m_search == 0) clear();  // Wrapped: old entries would match again
+    m_stats = Stats();
+  }
+
+  const Stats& stats() const { return m_stats; }
+
+  bool contains(uint64_t hash) {
+    m_stats.probes++;
+    const Bucket& b = m_buckets[hash & m_mask];
+    for (const Entry& e : b.entries) {
+      if (e.hash == hash && e.search == m_search) {
+        m_stats.hits++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Stores a position that took the given number of nodes to prove.
+  void insert(uint64_t hash, int64_t work) {
+    m_stats.stores++;
+    Bucket& b = m_buckets[hash & m_mask];
+    Entry* victim = nullptr;
+    for (Entry& e : b.entries) {
+      if (e.search != m_search || e.hash == hash) {
+        victim = &e;
+        break;
+      }
+    }
+    if (!victim) {
+      m_stats.collisions++;
+      victim = &b.entries[0];
+      for (Entry& e : b.entries) {
+        if (m_replacement == Replacement::Work ? e.work < victim->work
+                                               : e.stored < victim->stored)
+          victim = &e;
+      }
+    }
+    victim->hash = hash;
+    victim->work = uint16_t(std::min<int64_t>(work, UINT16_MAX));
+    victim->search = m_search;
+    victim->stored = m_stored++;
+  }
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    uint32_t stored;  // Order of stores, for Replacement::Age
+    uint16_t work;
+    uint16_t search;  // 0: never used
+  };
+
+  struct alignas(64) Bucket {
+    Entry entries[EntriesPerBucket];
+  };
+
+  static_assert(sizeof(Bucket) == 64, "A bucket is one cache line");
+
+  void clear() {
+    std::memset(static_cast<void*>(m_buckets.get()), 0,
+                size_t(byteSize()));
+    m_search = 1;
+  }
+
+  std::unique_ptr<Bucket[]> m_buckets;
+  size_t m_mask = 0;
+  Replacement m_replacement;
+  uint16_t m_search = 1;
+  uint32_t m_stored = 0;
+  Stats m_stats;
+};
+
+#endif  // TRANSPOSITIONTABLE_HPP
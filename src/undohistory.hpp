@@ -0,0 +1,101 @@
+#ifndef UNDOHISTORY_HPP
+#define UNDOHISTORY_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "boardstate.hpp"
+
+/**
+ * @file undohistory.hpp
+ * @brief Undo and redo of moves as deltas on a BoardState.
+ *
+ * Only what a step changed is kept: the two slots of a removed pair and
+ * their kinds, or the permutation a shuffle applied. A move therefore costs
+ * a few bytes no matter how large the board is, and the history has no
+ * depth limit. Starting a new move drops the steps that were undone.
+ */
+
+class UndoHistory {
+ public:
+  struct Step {
+    int32_t first = -1;  // Removed pair, or -1 for a shuffle
+    int32_t second = -1;
+    uint8_t firstKind = 0;
+    uint8_t secondKind = 0;
+    std::vector<int32_t> permutation;  // Shuffles only, see permute()
+
+    bool isShuffle() const { return first < 0; }
+  };
+
+  void clear() {
+    m_steps.clear();
+    m_next = 0;
+  }
+
+  bool canUndo() const { return m_next > 0; }
+  bool canRedo() const { return m_next < m_steps.size(); }
+  size_t depth() const { return m_next; }
+  size_t size() const { return m_steps.size(); }
+
+  // Heap memory held by the history.
+  size_t byteSize() const {
+    size_t bytes = m_steps.capacity() * sizeof(Step);
+    for (const Step& step : m_steps)
+      bytes += step.permutation.capacity() * sizeof(int32_t);
+    return bytes;
+  }
+
+  // Records a pair that is about to be removed from @p state.
+  void pushPair(const BoardState& state, int first, int second) {
+    Step step;
+    step.first = first;
+    step.second = second;
+    step.firstKind = uint8_t(state.kind(first));
+    step.secondKind = uint8_t(state.kind(second));
+    push(std::move(step));
+  }
+
+  void pushShuffle(std::vector<int32_t> permutation) {
+    Step step;
+    step.permutation = std::move(permutation);
+    push(std::move(step));
+  }
+
+  // Reverts the last step on the state and returns it, or nullptr.
+  const Step* undo(BoardState& state) {
+    if (!canUndo()) return nullptr;
+    const Step& step = m_steps[--m_next];
+    if (step.isShuffle()) {
+      state.permute(step.permutation, true);
+    } else {
+      state.set(step.first, step.firstKind);
+      state.set(step.second, step.secondKind);
+    }
+    return &step;
+  }
+
+  // Applies the next undone step again and returns it, or nullptr.
+  const Step* redo(BoardState& state) {
+    if (!canRedo()) return nullptr;
+    const Step& step = m_steps[m_next++];
+    if (step.isShuffle())
+      state.permute(step.permutation, false);
+    else
+      state.removePair(step.first, step.second);
+    return &step;
+  }
+
+ private:
+  void push(Step step) {
+    m_steps.resize(m_next);
+    m_steps.push_back(std::move(step));
+    ++m_next;
+  }
+
+  std::vector<Step> m_steps;
+  size_t m_next = 0;  // Steps before this index are applied
+};
+
+#endif  // UNDOHISTORY_HPP
@@ -0,0 +1,172 @@
+#ifndef WINESTIMATOR_HPP
+#define WINESTIMATOR_HPP
+
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "boardstate.hpp"
+#include "rng.hpp"
+
+/**
+ * @file winestimator.hpp
+ * @brief Monte Carlo estimate of the chance to clear a position.
+ *
+ * A playout removes random removable pairs until the board is cleared
+ * (a win) or no pair is left; shuffles are not played. The share of won
+ * playouts estimates how likely the position is to be cleared without a
+ * shuffle by a player who picks moves blindly, which is what the game
+ * uses to decide when to offer a free shuffle.
+ *
+ * WinEstimator runs the playouts on its own thread. estimate() only copies
+ * the position and bumps a generation counter; the worker notices the new
+ * generation between two playouts and starts over, so restarting after a
+ * move costs the UI thread nothing.
+ */
+
+struct WinEstimate {
+  int64_t playouts = 0;
+  int64_t wins = 0;
+
+  double probability() const {
+    return playouts > 0 ? double(wins) / double(playouts) : 0.0;
+  }
+
+  // Wilson score interval at the given z (1.96: 95% confidence).
+  double low(double z = 1.96) const { return interval(z, -1); }
+  double high(double z = 1.96) const { return interval(z, 1); }
+
+  // Plays one random game from the position; true if it was cleared. With
+  // lines, it is multiplied by the pairs available at every step: the
+  // number of games the playout stands for (Knuth's estimator).
+  static bool playout(BoardState state, Rng& rng, std::vector<Move>* scratch,
+                      double* lines = nullptr) {
+    while (!state.isCleared()) {
+      scratch->clear();
+      state.appendMoves(scratch);
+      if (scratch->empty()) return false;
+      if (lines) *lines *= double(scratch->size());
+      const Move& m = (*scratch)[rng.bounded(uint32_t(scratch->size()))];
+      state.removePair(m.first, m.second);
+    }
+    return true;
+  }
+
+ private:
+  double interval(double z, int sign) const {
+    if (playouts == 0) return sign < 0 ? 0.0 : 1.0;
+    const double n = double(playouts);
+    const double p = probability();
+    const double centre = p + z * z / (2 * n);
+    const double spread =
+        z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+    return std::min(1.0, std::max(0.0, (centre + sign * spread) /
+                                           (1 + z * z / n)));
+  }
+};
+
+class WinEstimator : public QObject {
+  Q_OBJECT
+ public:
+  // Playouts between two updates, and in total per position.
+  static constexpr int BatchSize = 64;
+  static constexpr int64_t DefaultMaxPlayouts = 4096;
+
+  explicit WinEstimator(QObject* parent = nullptr) : QObject(parent) {
+    m_thread.reset(QThread::create([this] { run(); }));
+    m_thread->start();
+  }
+
+  ~WinEstimator() override {
+    {
+      QMutexLocker lock(&m_mutex);
+      m_stop = true;
+      m_generation++;
+      m_wake.wakeOne();
+    }
+    m_thread->wait();
+  }
+
+  int64_t maxPlayouts() const { return m_maxPlayouts; }
+  void setMaxPlayouts(int64_t count) { m_maxPlayouts = count; }
+
+  // Starts estimating a new position; estimates of older ones are dropped.
+  void estimate(const BoardState& state) {
+    QMutexLocker lock(&m_mutex);
+    m_state = state;
+    m_pending = true;
+    m_generation++;
+    m_wake.wakeOne();
+  }
+
+  // Stops estimating until the next estimate().
+  void cancel() {
+    QMutexLocker lock(&m_mutex);
+    m_pending = false;
+    m_generation++;
+  }
+
+ signals:
+  // Emitted after every batch of playouts, in the thread the estimator
+  // lives in (not the worker).
+  void estimated(const WinEstimate& estimate);
+
+ private:
+  void run() {
+    std::vector<Move> scratch;
+    for (;;) {
+      BoardState state;
+      uint64_t generation;
+      {
+        QMutexLocker lock(&m_mutex);
+        while (!m_stop && !m_pending) m_wake.wait(&m_mutex);
+        if (m_stop) return;
+        m_pending = false;
+        generation = m_generation;
+        state = m_state;
+      }
+
+      Rng rng(generation);
+      WinEstimate result;
+      const int64_t maxPlayouts = m_maxPlayouts;
+      while (result.playouts < maxPlayouts && m_generation == generation) {
+        for (int i = 0; i < BatchSize && m_generation == generation; ++i) {
+          result.wins += WinEstimate::playout(state, rng, &scratch) ? 1 : 0;
+          result.playouts++;
+        }
+        publish(generation, result);
+      }
+    }
+  }
+
+  // Hands a result to the estimator's thread unless it is outdated by then.
+  void publish(uint64_t generation, const WinEstimate& result) {
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, result] {
+          if (m_generation == generation) emit estimated(result);
+        },
+        Qt::QueuedConnection);
+  }
+
+  QMutex m_mutex;
+  QWaitCondition m_wake;
+  BoardState m_state;  // Guarded by m_mutex, like the two flags
+  bool m_pending = false;
+  bool m_stop = false;
+  std::atomic<uint64_t> m_generation{0};
+  std::atomic<int64_t> m_maxPlayouts{DefaultMaxPlayouts};
+  std::unique_ptr<QThread> m_thread;
+};
+
+Q_DECLARE_METATYPE(WinEstimate)
+
+#endif  // WINESTIMATOR_HPP
@@ -2,6 +2,8 @@
 #include <QtTest>
 
 #include "test_board.hpp"
+#include "test_layout.hpp"
+#include "test_solver.hpp"
 #include "test_tile.hpp"
 
 int main(int argc, char *argv[]) {
@@ -13,6 +15,14 @@ int main(int argc, char *argv[]) {
     TestBoard tc;
     status |= QTest::qExec(&tc, argc, argv);
   }
+  {
+    TestLayout tc;
+    status |= QTest::qExec(&tc, argc, argv);
+  }
+  {
+    TestSolver tc;
+    status |= QTest::qExec(&tc, argc, argv);
+  }
   {
     TestTile tc;
     status |= QTest::qExec(&tc, argc, argv);
@@ -1,10 +1,16 @@
 #include "test_board.hpp"
 
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
 #include <QtTest>
 
 #include "board.hpp"
+#include "replayarchive.hpp"
+#include "telemetry.hpp"
 #include "tile.hpp"
 #include "tilemodel.hpp"
+#include "winestimator.hpp"
 
 void TestBoard::initTestCase() {
   // Setup before any test
@@ -157,6 +163,611 @@ void TestBoard::testNonMatchingPairResetsSelection() {
   QVERIFY(!tileB->selected());
 }
 
+void TestBoard::testSyntheticLayout() {
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  board.generateLayout(Layout::synthetic(1000, 8));
+
+  QCOMPARE(model.rowCount(), 1000);
+
+  // Every face must come in pairs so the deal can be cleared.
+  QHash<int, int> classCounts;
+  for (Tile* t : model.allTiles()) {
+    int kind = TileKind::fromFace(t->type().toLatin1().constData(), t->value());
+    QVERIFY(kind != TileKind::None);
+    classCounts[TileKind::matchClass(kind)]++;
+  }
+  for (int count : classCounts) QVERIFY(count % 2 == 0);
+}
+
+void TestBoard::testSeededDealIsReproducible() {
+  auto faces = [](const TileModel& model) {
+    QStringList list;
+    for (Tile* t : model.allTiles())
+      list << QString("%1%2@%3,%4,%5")
+                  .arg(t->type())
+                  .arg(t->value())
+                  .arg(t->row())
+                  .arg(t->column())
+                  .arg(t->layer());
+    return list;
+  };
+
+  TileModel modelA, modelB;
+  Board boardA(&modelA), boardB(&modelB);
+  boardA.generateTurtleLayout(42);
+  boardB.generateTurtleLayout(42);
+  QCOMPARE(boardA.seed(), quint64(42));
+  QCOMPARE(faces(modelA), faces(modelB));
+
+  boardA.shuffle();
+  boardB.shuffle();
+  QCOMPARE(faces(modelA), faces(modelB));
+
+  boardA.shuffle(7);
+  boardB.shuffle(7);
+  QCOMPARE(faces(modelA), faces(modelB));
+
+  boardB.generateTurtleLayout(43);
+  QVERIFY(faces(modelA) != faces(modelB));
+}
+
+void TestBoard::testDealDatabase() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("deals.mjdd");
+  const Layout turtle = Layout::turtle();
+
+  std::vector<std::vector<uint8_t>> kinds;
+  DealDatabaseWriter writer;
+  QVERIFY(writer.open(path, turtle, 100));
+  for (quint64 seed = 100; seed < 103; ++seed) {
+    Rng rng(seed);
+    kinds.push_back(Board::dealKinds(turtle.size(), rng));
+    QVERIFY(writer.append(kinds.back(),
+                          seed == 101 ? Solvability::Solvable
+                                      : Solvability::Unknown,
+                          uint8_t(seed - 100)));
+  }
+  QVERIFY(writer.finish());
+
+  DealDatabase deals;
+  QString error;
+  QVERIFY2(deals.open(path, &error), qPrintable(error));
+  QCOMPARE(deals.count(), qint64(3));
+  QVERIFY(deals.matches(turtle));
+  QCOMPARE(deals.seed(2), uint64_t(102));
+  const Deal d = deals.deal(1);
+  QCOMPARE(int(d.solvability), int(Solvability::Solvable));
+  QCOMPARE(int(d.difficulty), 1);
+  QVERIFY(std::equal(kinds[1].begin(), kinds[1].end(), d.kinds));
+
+  // A deal from the database is the game of its seed, shuffles included.
+  TileModel model, seededModel;
+  Board board(&model), seeded(&seededModel);
+  board.setDealDatabase(&deals);
+  QVERIFY(board.generateFromDeal(1));
+  QCOMPARE(board.dealIndex(), qint64(1));
+  QCOMPARE(board.seed(), quint64(101));
+  QCOMPARE(board.state().kinds(), kinds[1]);
+  seeded.generateTurtleLayout(101);
+  QCOMPARE(seeded.state().kinds(), board.state().kinds());
+  board.shuffle();
+  seeded.shuffle();
+  QCOMPARE(seeded.state().kinds(), board.state().kinds());
+
+  QVERIFY(!board.generateFromDeal(3));
+  QVERIFY(!board.generateFromDeal(-1));
+  QCOMPARE(board.dealIndex(), qint64(1));
+
+  // Databases without the first seed are rejected.
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  const uint32_t oldVersion = 1;
+  QVERIFY(file.seek(4));
+  QVERIFY(file.write(reinterpret_cast<const char*>(&oldVersion),
+                     sizeof oldVersion) == qint64(sizeof oldVersion));
+  file.close();
+  DealDatabase old;
+  QVERIFY(!old.open(path, &error));
+  QVERIFY(!DealDatabase().open(dir.filePath("missing.mjdd")));
+}
+
+void TestBoard::testStartDealtMatchesGenerate() {
+  // A deal made on another thread, as at startup, is the seeded deal.
+  Rng rng(42);
+  BoardState dealt(Layout::turtle());
+  dealt.deal(rng);
+
+  TileModel modelA, modelB;
+  Board boardA(&modelA), boardB(&modelB);
+  boardA.generateTurtleLayout(42);
+  QSignalSpy resets(&modelB, &QAbstractItemModel::modelReset);
+  QSignalSpy inserts(&modelB, &QAbstractItemModel::rowsInserted);
+  boardB.startDealt(dealt, 42, rng);
+  QCOMPARE(resets.count(), 1);
+  QCOMPARE(inserts.count(), 0);
+  QCOMPARE(modelB.rowCount(), 144);
+
+  QCOMPARE(boardB.seed(), quint64(42));
+  QCOMPARE(boardB.state().kinds(), boardA.state().kinds());
+  boardA.shuffle();
+  boardB.shuffle();
+  QCOMPARE(boardB.state().kinds(), boardA.state().kinds());
+}
+
+void TestBoard::testShuffleKeepsConnectionCount() {
+  TileModel model;
+  Board board(&model);
+  board.generateTurtleLayout();
+  board.shuffle();
+  board.shuffle();
+
+  for (Tile* t : model.allTiles()) QCOMPARE(t->connectionCount(), 8);
+
+  MemoryReport report = board.memoryReport();
+  QVERIFY(report.totalBytes() > 0);
+  QCOMPARE(report.entries().first().count, qint64(model.rowCount()));
+}
+
+void TestBoard::testSaveAndRestore() {
+  TileModel modelA, modelB;
+  Board boardA(&modelA), boardB(&modelB);
+  boardA.setSoundsEnabled(false);
+  boardA.generateTurtleLayout(42);
+  QVector<QPair<Tile*, Tile*>> moves = boardA.availableMoves();
+  QVERIFY(!moves.isEmpty());
+  boardA.selectTile(moves[0].first->row(), moves[0].first->column());
+  boardA.selectTile(moves[0].second->row(), moves[0].second->column());
+  Tile* open = boardA.availableMoves().first().first;
+  boardA.selectTile(open->row(), open->column());
+
+  const QByteArray bytes = boardA.saveState();
+  QCOMPARE(bytes.size(), qsizetype(sizeof(SaveGame::Header) + 144));
+
+  QSignalSpy resets(&modelB, &QAbstractItemModel::modelReset);
+  QSignalSpy inserts(&modelB, &QAbstractItemModel::rowsInserted);
+  QVERIFY(boardB.restoreState(bytes));
+  QCOMPARE(resets.count(), 1);
+  QCOMPARE(inserts.count(), 0);
+
+  QCOMPARE(modelB.rowCount(), modelA.rowCount());
+  QCOMPARE(boardB.state().kinds(), boardA.state().kinds());
+  QCOMPARE(boardB.seed(), quint64(42));
+  for (int i = 0; i < modelA.rowCount(); ++i) {
+    QCOMPARE(modelB.tileAt(i)->selected(), modelA.tileAt(i)->selected());
+    QCOMPARE(modelB.tileAt(i)->open(), modelA.tileAt(i)->open());
+  }
+
+  // The generator state is part of the save, so shuffles continue alike.
+  boardA.shuffle();
+  boardB.shuffle();
+  QCOMPARE(boardB.state().kinds(), boardA.state().kinds());
+
+  QVERIFY(!boardB.restoreState(bytes.left(100)));
+  QCOMPARE(boardB.state().kinds(), boardA.state().kinds());
+}
+
+void TestBoard::testAutosave() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("autosave.mjsv");
+  auto saved = [&path] {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+  };
+
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  board.generateTurtleLayout(42);
+  board.setAutosavePath(path);
+  QCOMPARE(board.autosavePath(), path);
+
+  // Selecting a tile and a mismatch change nothing worth saving.
+  const QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+  QVERIFY(!moves.isEmpty());
+  Tile* other = nullptr;
+  for (int i = 0; i < model.rowCount() && !other; ++i) {
+    Tile* t = model.tileAt(i);
+    if (t->open() && t->type() != moves[0].first->type()) other = t;
+  }
+  QVERIFY(other);
+  board.selectTile(moves[0].first->row(), moves[0].first->column());
+  board.selectTile(other->row(), other->column());
+  board.flushAutosave();
+  QVERIFY(!QFile::exists(path));
+
+  // A quick series of matches ends up as the newest position.
+  for (int i = 0; i < 3; ++i) {
+    const QPair<Tile*, Tile*> m = board.availableMoves().first();
+    board.selectTile(m.first->row(), m.first->column());
+    board.selectTile(m.second->row(), m.second->column());
+  }
+  board.flushAutosave();
+  QCOMPARE(saved(), board.saveState());
+
+  board.undo();
+  board.flushAutosave();
+  QCOMPARE(saved(), board.saveState());
+
+  // Detaching writes what is still waiting.
+  board.shuffle();
+  board.setAutosavePath(QString());
+  QCOMPARE(saved(), board.saveState());
+}
+
+void TestBoard::testReplayLogReproducesGame() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("replay.mjrl");
+
+  TileModel model, restoredModel;
+  Board board(&model), restored(&restoredModel);
+  board.setSoundsEnabled(false);
+  ReplayWriter writer;
+  QVERIFY(writer.open(path));
+  board.setReplayLog(&writer);
+  restored.setReplayLog(&writer);
+
+  board.generateTurtleLayout(42);
+  for (int i = 0; i < 5; ++i) {
+    QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+    if (moves.isEmpty()) break;
+    board.selectTile(moves[0].first->row(), moves[0].first->column());
+    board.selectTile(moves[0].second->row(), moves[0].second->column());
+  }
+  board.shuffle();
+  board.shuffle(7);
+  board.setSolvableShuffles(true);
+  board.shuffle();
+  QVERIFY(restored.restoreState(board.saveState()));
+  restored.shuffle();
+  writer.close();
+
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QByteArray bytes = file.readAll();
+  const qsizetype headerSize = sizeof(ReplayFormat::FileHeader);
+  QCOMPARE((bytes.size() - headerSize) % 16, qsizetype(0));
+  const auto* begin = reinterpret_cast<const ReplayFormat::Record*>(
+      bytes.constData() + headerSize);
+  const auto* end = begin + (bytes.size() - headerSize) / 16;
+
+  // Replay the first game up to the restore, then the restored one.
+  Replayer replayer(Layout::turtle());
+  const auto* second = std::find_if(begin + 1, end, [](const auto& r) {
+    return r.type == ReplayFormat::NewGame;
+  });
+  QCOMPARE(replayer.apply(begin, second), int64_t(second - begin));
+  QCOMPARE(replayer.state().kinds(), board.state().kinds());
+  QCOMPARE(replayer.games(), int64_t(1));
+
+  QCOMPARE(replayer.apply(second, end), int64_t(end - second));
+  QCOMPARE(replayer.state().kinds(), restored.state().kinds());
+  QCOMPARE(replayer.games(), int64_t(2));
+
+  // Nothing logged while the writer is closed ends up in the next log.
+  board.shuffle();
+  QVERIFY(writer.open(dir.filePath("next.mjrl")));
+  writer.close();
+  QCOMPARE(QFile(dir.filePath("next.mjrl")).size(), qint64(headerSize));
+}
+
+void TestBoard::testReplayArchive() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString logPath = dir.filePath("replay.mjrl");
+  const QString archivePath = dir.filePath("games.mjra");
+
+  // Enough games for more than one block.
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  ReplayWriter writer;
+  QVERIFY(writer.open(logPath));
+  board.setReplayLog(&writer);
+  const int games = 1500;
+  for (int seed = 1; seed <= games; ++seed) {
+    board.generateTurtleLayout(quint64(seed));
+    QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+    board.selectTile(moves[0].first->row(), moves[0].first->column());
+    board.selectTile(moves[0].second->row(), moves[0].second->column());
+  }
+  writer.close();
+
+  QFile file(logPath);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QByteArray bytes = file.readAll();
+  const qsizetype headerSize = sizeof(ReplayFormat::FileHeader);
+  const auto* begin = reinterpret_cast<const ReplayFormat::Record*>(
+      bytes.constData() + headerSize);
+  const auto* end = begin + (bytes.size() - headerSize) / 16;
+
+  ReplayArchiveWriter archiveWriter;
+  QVERIFY(archiveWriter.open(archivePath));
+  QVERIFY(archiveWriter.addLog(begin, end));
+  QVERIFY(archiveWriter.finish());
+
+  ReplayArchive archive;
+  QVERIFY(archive.open(archivePath));
+  QCOMPARE(archive.gameCount(), qint64(games));
+  QVERIFY(archive.blockCount() > 1);
+  QCOMPARE(archive.findSeed(games + 1), qint64(-1));
+
+  // Every game comes back unchanged, whichever block it is in.
+  qint64 id = 0;
+  ArchiveFormat::forEachGame(
+      begin, end,
+      [&](const ReplayFormat::Record* game, const ReplayFormat::Record* e) {
+        QCOMPARE(archive.findSeed(uint64_t(id + 1)), id);
+        const std::vector<ReplayFormat::Record> records =
+            archive.gameRecords(id++);
+        QCOMPARE(records.size(), size_t(e - game));
+        QVERIFY(std::memcmp(records.data(), game,
+                            records.size() * sizeof *game) == 0);
+      });
+  QCOMPARE(id, qint64(games));
+
+  // An extracted game replays to the position the board was left in.
+  const std::vector<ReplayFormat::Record> last =
+      archive.gameRecords(archive.findSeed(games));
+  Replayer replayer(Layout::turtle());
+  QCOMPARE(replayer.apply(last.data(), last.data() + last.size()),
+           int64_t(last.size()));
+  QCOMPARE(replayer.state().kinds(), board.state().kinds());
+
+  // A damaged index is rejected, not read.
+  QVERIFY(QFile::resize(archivePath, QFile(archivePath).size() - 1));
+  ReplayArchive damaged;
+  QVERIFY(!damaged.open(archivePath));
+}
+
+void TestBoard::testTelemetry() {
+  SpscQueue<int> queue(4);
+  for (int i = 0; i < 4; ++i) QVERIFY(queue.push(i));
+  QVERIFY(!queue.push(4));
+  int item = -1;
+  QVERIFY(queue.pop(&item));
+  QCOMPARE(item, 0);
+  QVERIFY(queue.push(4));
+  for (int i = 1; i <= 4; ++i) {
+    QVERIFY(queue.pop(&item));
+    QCOMPARE(item, i);
+  }
+  QVERIFY(!queue.pop(&item));
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("telemetry.ndjson");
+  TelemetrySink sink;
+  QVERIFY(sink.open(path));
+
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  board.setTelemetry(&sink);
+  board.generateTurtleLayout(42);
+  QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+  const int first = board.state().layout().slotAt(
+      moves[0].first->row(), moves[0].first->column(),
+      moves[0].first->layer());
+  board.selectTile(moves[0].first->row(), moves[0].first->column());
+  board.selectTile(moves[0].second->row(), moves[0].second->column());
+  board.shuffle();
+  QVERIFY(board.undo());
+  board.generateTurtleLayout(43);
+  sink.close();
+  QCOMPARE(sink.dropped(), qint64(0));
+
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QList<QByteArray> lines = file.readAll().split('\n');
+  QCOMPARE(lines.size(), 7);  // Six events and the empty rest
+  QVERIFY(lines.last().isEmpty());
+
+  QStringList events;
+  for (int i = 0; i < 6; ++i) {
+    QJsonParseError error;
+    const QJsonObject o = QJsonDocument::fromJson(lines[i], &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QVERIFY(o["micros"].toInteger() >= 0);
+    events << o["event"].toString();
+  }
+  QCOMPARE(events, QStringList({"start", "move", "shuffle", "undo", "end",
+                                "start"}));
+
+  const QJsonObject start = QJsonDocument::fromJson(lines[0]).object();
+  QCOMPARE(start["seed"].toInteger(), qint64(42));
+  QCOMPARE(start["slots"].toInt(), 144);
+  QCOMPARE(start["remaining"].toInt(), 144);
+  const QJsonObject move = QJsonDocument::fromJson(lines[1]).object();
+  QCOMPARE(move["first"].toInt(), first);
+  QVERIFY(move["match"].toBool());
+  QCOMPARE(move["remaining"].toInt(), 142);
+  const QJsonObject end = QJsonDocument::fromJson(lines[4]).object();
+  QCOMPARE(end["result"].toString(), QString("abandoned"));
+  QCOMPARE(end["seed"].toInteger(), qint64(42));
+  QCOMPARE(QJsonDocument::fromJson(lines[5]).object()["seed"].toInteger(),
+           qint64(43));
+
+  // Events a full disk refuses are counted as dropped too.
+  if (QFile::exists("/dev/full")) {
+    TelemetrySink full;
+    QVERIFY(full.open("/dev/full"));
+    full.post(TelemetryEvent::make(TelemetryEvent::Shuffle, 42, 144));
+    full.close();
+    QCOMPARE(full.dropped(), qint64(1));
+  }
+}
+
+void TestBoard::testWinProbability() {
+  QCOMPARE(WinEstimate().low(), 0.0);
+  QCOMPARE(WinEstimate().high(), 1.0);
+  WinEstimate half;
+  half.playouts = 100;
+  half.wins = 50;
+  QVERIFY(half.low() > 0.39 && half.low() < 0.5);
+  QVERIFY(half.high() > 0.5 && half.high() < 0.61);
+
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  WinEstimator estimator;
+  estimator.setMaxPlayouts(512);
+  board.setWinEstimator(&estimator);
+  board.generateTurtleLayout(2);
+  QTRY_COMPARE_WITH_TIMEOUT(board.winPlayouts(), qint64(512), 30000);
+  QVERIFY(board.winProbabilityLow() <= board.winProbability());
+  QVERIFY(board.winProbability() <= board.winProbabilityHigh());
+
+  // A move restarts the estimate for the new position.
+  QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+  board.selectTile(moves[0].first->row(), moves[0].first->column());
+  board.selectTile(moves[0].second->row(), moves[0].second->column());
+  QCOMPARE(board.winPlayouts(), qint64(0));
+  QTRY_COMPARE_WITH_TIMEOUT(board.winPlayouts(), qint64(512), 30000);
+
+  // Two stacks with crossed kinds can never be cleared.
+  BoardState crossed(Layout("stacks", {{0, 0, 0}, {0, 0, 1}, {0, 5, 0},
+                                       {0, 5, 1}}));
+  crossed.set(0, TileKind::FirstBamboo);
+  crossed.set(1, TileKind::FirstCircle);
+  crossed.set(2, TileKind::FirstCircle);
+  crossed.set(3, TileKind::FirstBamboo);
+  Rng rng(1);
+  std::vector<Move> scratch;
+  QVERIFY(!WinEstimate::playout(crossed, rng, &scratch));
+  crossed.set(3, TileKind::FirstCircle);
+  crossed.set(2, TileKind::FirstBamboo);
+  QVERIFY(WinEstimate::playout(crossed, rng, &scratch));
+}
+
+void TestBoard::testAvailablePairs() {
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  QSignalSpy stuck(&board, &Board::noMovesLeft);
+
+  // Always taking the first move gets stuck on most deals; play until one
+  // does, checking the count against a full recount on the way.
+  bool wasStuck = false;
+  for (quint64 seed = 1; seed <= 20 && !wasStuck; ++seed) {
+    board.generateTurtleLayout(seed);
+    for (int step = 0;; ++step) {
+      QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+      QCOMPARE(board.availablePairs(), int(moves.size()));
+      if (moves.isEmpty()) break;
+      if (step % 5 == 4) {
+        QVERIFY(board.undo());
+        QCOMPARE(board.availablePairs(), int(board.availableMoves().size()));
+        QVERIFY(board.redo());
+        QCOMPARE(board.availablePairs(), int(moves.size()));
+      }
+      board.selectTile(moves[0].first->row(), moves[0].first->column());
+      board.selectTile(moves[0].second->row(), moves[0].second->column());
+    }
+    wasStuck = !board.state().isCleared();
+    QCOMPARE(stuck.count(), wasStuck ? 1 : 0);
+  }
+  QVERIFY(wasStuck);
+
+  // Undoing the last match brings its pair back.
+  QVERIFY(board.undo());
+  QVERIFY(board.availablePairs() > 0);
+  QCOMPARE(board.availablePairs(), int(board.availableMoves().size()));
+
+  board.shuffle(7);
+  QCOMPARE(board.availablePairs(), int(board.availableMoves().size()));
+}
+
+void TestBoard::testUndoRedo() {
+  // The model must always show exactly the state, with correct open flags.
+  auto consistent = [](const Board& board, const TileModel& model) {
+    if (model.rowCount() != board.state().remaining()) return false;
+    for (Tile* t : model.allTiles()) {
+      int slot =
+          board.state().layout().slotAt(t->row(), t->column(), t->layer());
+      int kind =
+          TileKind::fromFace(t->type().toLatin1().constData(), t->value());
+      if (slot < 0 || board.state().kind(slot) != kind ||
+          t->open() != board.state().isOpen(slot))
+        return false;
+    }
+    return true;
+  };
+
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  board.generateTurtleLayout(42);
+  QVERIFY(!board.canUndo());
+
+  QVector<std::vector<uint8_t>> history = {board.state().kinds()};
+  for (int i = 0; i < 6; ++i) {
+    if (i == 3) {
+      board.shuffle();
+    } else {
+      QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+      if (moves.isEmpty()) break;
+      board.selectTile(moves[0].first->row(), moves[0].first->column());
+      board.selectTile(moves[0].second->row(), moves[0].second->column());
+    }
+    history.append(board.state().kinds());
+  }
+  QVERIFY(board.canUndo());
+
+  for (int i = history.size() - 2; i >= 0; --i) {
+    QVERIFY(board.undo());
+    QCOMPARE(board.state().kinds(), history[i]);
+    QVERIFY(consistent(board, model));
+  }
+  QVERIFY(!board.undo());
+  QVERIFY(board.canRedo());
+
+  for (int i = 1; i < history.size(); ++i) {
+    QVERIFY(board.redo());
+    QCOMPARE(board.state().kinds(), history[i]);
+    QVERIFY(consistent(board, model));
+  }
+  QVERIFY(!board.canRedo());
+
+  // A new move after an undo drops the undone steps.
+  QVERIFY(board.undo());
+  board.shuffle();
+  QVERIFY(!board.canRedo());
+}
+
+void TestBoard::testSnapshotBranches() {
+  TileModel model;
+  Board board(&model);
+  board.generateTurtleLayout(42);
+  QSignalSpy changes(&model, &QAbstractItemModel::dataChanged);
+
+  const BoardSnapshot root = board.snapshot();
+  const BoardSnapshot fork = root;
+  QVERIFY(fork.sharesStateWith(root));
+
+  // Play a branch on snapshots and the same moves on a mutable state.
+  BoardSnapshot branch = root;
+  BoardState expected = board.state();
+  for (int i = 0; i < 10; ++i) {
+    std::vector<Move> moves;
+    branch.appendMoves(&moves);
+    if (moves.empty()) break;
+    branch = branch.apply(moves.back());
+    expected.removePair(moves.back().first, moves.back().second);
+  }
+  QCOMPARE(branch.toState().kinds(), expected.kinds());
+
+  // Neither the root nor the live game moved.
+  QCOMPARE(root.remaining(), 144);
+  QCOMPARE(root.toState().kinds(), board.state().kinds());
+  QCOMPARE(model.rowCount(), 144);
+  QCOMPARE(changes.count(), 0);
+}
+
 void TestBoard::cleanupTestCase() {
   // After all tests
 }
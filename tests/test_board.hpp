@@ -13,6 +13,20 @@ class TestBoard : public QObject {
   void testSelectCoveredTile();
   void testShuffle();
   void testNonMatchingPairResetsSelection();
+  void testSyntheticLayout();
+  void testSeededDealIsReproducible();
+  void testDealDatabase();
+  void testStartDealtMatchesGenerate();
+  void testShuffleKeepsConnectionCount();
+  void testSaveAndRestore();
+  void testAutosave();
+  void testReplayLogReproducesGame();
+  void testReplayArchive();
+  void testTelemetry();
+  void testWinProbability();
+  void testAvailablePairs();
+  void testUndoRedo();
+  void testSnapshotBranches();
   void cleanupTestCase();
 };
 
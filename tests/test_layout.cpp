@@ -0,0 +1,147 @@
+#include "test_layout.hpp"
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <cstring>
+
+#include "layout.hpp"
+#include "layoutloader.hpp"
+
+namespace {
+
+// Two layers: a 2x3 block of tiles with two tiles on top of the first row.
+const char* smallLayout =
+    "kmahjongg-layout-v1.1\n"
+    "# test layout\n"
+    "w6\n"
+    "h4\n"
+    "d2\n"
+    "121212\n"
+    "434343\n"
+    "121212\n"
+    "434343\n"
+    "..1212\n"
+    "..4343\n"
+    "......\n"
+    "......\n";
+
+}  // namespace
+
+void TestLayout::testTurtleGraph() {
+  Layout turtle = Layout::turtle();
+  QCOMPARE(turtle.size(), 144);
+  QCOMPARE(turtle.layerCount(), 5);
+
+  auto all = [](int) { return true; };
+  int topSlot = turtle.slotAt(7, 7, 4);
+  QVERIFY(topSlot >= 0);
+  QVERIFY(turtle.isOpen(topSlot, all));
+  QCOMPARE(turtle.topmostAt(7, 7, all), topSlot);
+
+  // The slot under the top tile is covered until the top tile is gone.
+  int below = turtle.slotAt(7, 7, 3);
+  QVERIFY(!turtle.isOpen(below, all));
+  QVERIFY(turtle.isOpen(below, [topSlot](int s) { return s != topSlot; }));
+
+  // Row ends on the bottom layer are open, the middle is not.
+  QVERIFY(turtle.isOpen(turtle.slotAt(3, 3, 0), all));
+  QVERIFY(!turtle.isOpen(turtle.slotAt(3, 4, 0), all));
+}
+
+void TestLayout::testParseKMahjongg() {
+  QString error;
+  Layout layout =
+      LayoutLoader::parseKMahjongg(smallLayout, "small", 0, &error);
+  QVERIFY2(!layout.isEmpty(), qPrintable(error));
+  QCOMPARE(layout.size(), 8);
+  QCOMPARE(layout.layerCount(), 2);
+  QCOMPARE(layout.slotAt(0, 1, 1) >= 0, true);
+
+  auto all = [](int) { return true; };
+  QVERIFY(!layout.isOpen(layout.slotAt(0, 1, 0), all));
+  QVERIFY(layout.isOpen(layout.slotAt(0, 0, 0), all));
+}
+
+void TestLayout::testRejectsInvalidFiles() {
+  QString error;
+  QVERIFY(LayoutLoader::parseKMahjongg("hello", "x", 0, &error).isEmpty());
+  QVERIFY(!error.isEmpty());
+
+  // One tile only: odd tile counts cannot be dealt.
+  QVERIFY(LayoutLoader::parseKMahjongg(
+              "kmahjongg-layout-v1.1\nw2\nh2\nd1\n12\n43\n", "x", 0, &error)
+              .isEmpty());
+}
+
+void TestLayout::testCompiledCache() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  QString path = dir.filePath("small.layout");
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(smallLayout);
+  file.close();
+
+  LayoutLoader loader(dir.filePath("cache"));
+  Layout first = loader.load(path);
+  QVERIFY(!first.isEmpty());
+  QVERIFY(!loader.lastLoadWasCached());
+
+  Layout second = loader.load(path);
+  QVERIFY(loader.lastLoadWasCached());
+  QCOMPARE(second.size(), first.size());
+  QCOMPARE(second.name(), first.name());
+  for (int i = 0; i < first.size(); ++i) {
+    QCOMPARE(second.slot(i).row, first.slot(i).row);
+    QCOMPARE(second.slot(i).column, first.slot(i).column);
+    QCOMPARE(second.slot(i).layer, first.slot(i).layer);
+    QCOMPARE(second.left(i), first.left(i));
+    QCOMPARE(second.right(i), first.right(i));
+  }
+}
+
+void TestLayout::testRejectsTamperedCache() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString path = dir.filePath("small.layout");
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(smallLayout);
+  file.close();
+
+  LayoutLoader loader(dir.filePath("cache"));
+  Layout first = loader.load(path);
+  QVERIFY(!first.isEmpty());
+  const QStringList cached = QDir(dir.filePath("cache")).entryList(QDir::Files);
+  QCOMPARE(cached.size(), 1);
+
+  // Repeat the slot before the last in the cell slot table, which follows
+  // the 32-byte header, the cell keys and the cell offsets.
+  QFile cache(dir.filePath("cache/" + cached[0]));
+  QVERIFY(cache.open(QIODevice::ReadWrite));
+  QByteArray bytes = cache.readAll();
+  uint32_t cells;
+  std::memcpy(&cells, bytes.constData() + 20, sizeof cells);
+  const qsizetype cellSlots =
+      32 + ((8 * cells + 7) & ~7u) + ((4 * (cells + 1) + 7) & ~7u);
+  const qsizetype last = cellSlots + 4 * (first.size() - 1);
+  std::memcpy(bytes.data() + last, bytes.constData() + last - 4, 4);
+  QVERIFY(cache.seek(0));
+  QCOMPARE(cache.write(bytes), qint64(bytes.size()));
+  cache.close();
+
+  Layout attached;
+  QVERIFY(!Layout::fromBinary(bytes.constData(), size_t(bytes.size()),
+                              nullptr, &attached));
+
+  // The loader falls back to the layout file.
+  Layout second = loader.load(path);
+  QVERIFY(!loader.lastLoadWasCached());
+  QCOMPARE(second.size(), first.size());
+  for (int i = 0; i < first.size(); ++i) {
+    QCOMPARE(second.left(i), first.left(i));
+    QCOMPARE(second.right(i), first.right(i));
+  }
+}
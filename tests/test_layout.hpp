@@ -0,0 +1,16 @@
+#ifndef TEST_LAYOUT_HPP
+#define TEST_LAYOUT_HPP
+
+#include <QObject>
+
+class TestLayout : public QObject {
+  Q_OBJECT
+ private slots:
+  void testTurtleGraph();
+  void testParseKMahjongg();
+  void testRejectsInvalidFiles();
+  void testCompiledCache();
+  void testRejectsTamperedCache();
+};
+
+#endif  // TEST_LAYOUT_HPP
@@ -0,0 +1,466 @@
+#include "test_solver.hpp"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "beamsolver.hpp"
+#include "boardstate.hpp"
+#include "difficulty.hpp"
+#include "solutioncache.hpp"
+#include "solver.hpp"
+#include "solverservice.hpp"
+#include "tilemodel.hpp"
+#include "transpositiontable.hpp"
+#include "verify.hpp"
+
+namespace {
+
+// Two stacks of two tiles. With the kinds crossed (A under B, B under A)
+// the two open tiles never match.
+BoardState crossedStacks() {
+  BoardState state(Layout("stacks", {{0, 0, 0}, {0, 0, 1}, {0, 5, 0},
+                                     {0, 5, 1}}));
+  state.set(0, TileKind::FirstBamboo);
+  state.set(1, TileKind::FirstCircle);
+  state.set(2, TileKind::FirstCircle);
+  state.set(3, TileKind::FirstBamboo);
+  return state;
+}
+
+}  // namespace
+
+void TestSolver::testSolvesDeal() {
+  BoardState state(Layout::turtle());
+  Rng rng(2);
+  state.deal(rng);
+
+  Solver solver;
+  Solver::Result result = solver.solve(state);
+  QCOMPARE(int(result.status), int(Solver::Status::Solvable));
+  QCOMPARE(int(result.solution.size()), 72);
+
+  // The solution must be playable by the game rules.
+  for (const Move& m : result.solution) {
+    QVERIFY(state.canRemove(m.first, m.second));
+    state.removePair(m.first, m.second);
+  }
+  QVERIFY(state.isCleared());
+}
+
+void TestSolver::testProvesUnsolvable() {
+  Solver solver;
+  Solver::Result result = solver.solve(crossedStacks());
+  QCOMPARE(int(result.status), int(Solver::Status::Unsolvable));
+  QVERIFY(result.solution.empty());
+}
+
+void TestSolver::testNodeLimit() {
+  BoardState state(Layout::turtle());
+  Rng rng(2);
+  state.deal(rng);
+
+  Solver::Options options;
+  options.nodeLimit = 10;
+  Solver solver(options);
+  QCOMPARE(int(solver.solve(state).status), int(Solver::Status::Unknown));
+}
+
+void TestSolver::testReductionsKeepAnswers() {
+  // Positions 50 random pairs into a deal, solved exhaustively with and
+  // without safe moves and sleep sets.
+  int64_t plainNodes = 0, reducedNodes = 0;
+  for (quint64 seed = 1; seed <= 30; ++seed) {
+    BoardState state(Layout::turtle());
+    Rng rng(seed);
+    state.deal(rng);
+    std::vector<Move> moves;
+    for (int i = 0; i < 50; ++i) {
+      moves.clear();
+      state.appendMoves(&moves);
+      if (moves.empty()) break;
+      const Move& m = moves[rng.bounded(uint32_t(moves.size()))];
+      state.removePair(m.first, m.second);
+    }
+
+    Solver::Options plain;
+    plain.safeMoves = false;
+    plain.sleepSets = false;
+    const Solver::Result expected = Solver(plain).solve(state);
+    QVERIFY(expected.status != Solver::Status::Unknown);
+    plainNodes += expected.nodes;
+    const Solver::Result reduced = Solver().solve(state);
+    QCOMPARE(int(reduced.status), int(expected.status));
+    reducedNodes += reduced.nodes;
+
+    BoardState played = state;
+    for (const Move& m : reduced.solution) {
+      QVERIFY(played.canRemove(m.first, m.second));
+      played.removePair(m.first, m.second);
+    }
+    QCOMPARE(played.isCleared(),
+             reduced.status == Solver::Status::Solvable);
+  }
+  QVERIFY(reducedNodes < plainNodes);
+}
+
+void TestSolver::testMoveOrdering() {
+  // Every combination of orderings gives the same answers, with solutions
+  // that play out.
+  const unsigned all =
+      Solver::LastPair | Solver::FreesTiles | Solver::LongRows;
+  for (quint64 seed = 1; seed <= 10; ++seed) {
+    BoardState state(Layout::turtle());
+    Rng rng(seed);
+    state.deal(rng);
+    std::vector<Move> moves;
+    for (int i = 0; i < 50; ++i) {
+      moves.clear();
+      state.appendMoves(&moves);
+      if (moves.empty()) break;
+      const Move& m = moves[rng.bounded(uint32_t(moves.size()))];
+      state.removePair(m.first, m.second);
+    }
+
+    Solver::Options options;
+    options.ordering = 0;
+    const Solver::Result expected = Solver(options).solve(state);
+    QVERIFY(expected.status != Solver::Status::Unknown);
+    for (unsigned ordering = 1; ordering <= all; ++ordering) {
+      options.ordering = ordering;
+      const Solver::Result result = Solver(options).solve(state);
+      QCOMPARE(int(result.status), int(expected.status));
+      BoardState played = state;
+      for (const Move& m : result.solution) {
+        QVERIFY(played.canRemove(m.first, m.second));
+        played.removePair(m.first, m.second);
+      }
+      QCOMPARE(played.isCleared(),
+               result.status == Solver::Status::Solvable);
+    }
+  }
+}
+
+void TestSolver::testTranspositionTable() {
+  // One bucket: the hashes below all land in it.
+  for (auto policy : {TranspositionTable::Replacement::Work,
+                      TranspositionTable::Replacement::Age}) {
+    TranspositionTable table(100, policy);
+    QCOMPARE(table.byteSize(), int64_t(64));
+    QCOMPARE(table.capacity(), int64_t(4));
+    table.newSearch();
+    for (uint64_t h = 1; h <= 4; ++h) table.insert(h, int64_t(10 - h));
+    for (uint64_t h = 1; h <= 4; ++h) QVERIFY(table.contains(h));
+    QCOMPARE(table.stats().collisions, int64_t(0));
+
+    // Work evicts the cheapest entry (4), Age the first stored (1).
+    table.insert(5, 100);
+    QCOMPARE(table.stats().collisions, int64_t(1));
+    QVERIFY(table.contains(5));
+    const bool work = policy == TranspositionTable::Replacement::Work;
+    QCOMPARE(table.contains(4), !work);
+    QCOMPARE(table.contains(1), work);
+    QCOMPARE(table.stats().probes, int64_t(7));
+    QCOMPARE(table.stats().hits, int64_t(6));
+    QCOMPARE(table.stats().misses(), int64_t(1));
+
+    table.newSearch();
+    QVERIFY(!table.contains(5));
+    QCOMPARE(table.stats().hits, int64_t(0));
+  }
+
+  // A tiny table costs nodes, never correctness.
+  BoardState state = crossedStacks();
+  Solver::Options options;
+  options.tableBytes = 64;
+  Solver solver(options);
+  QCOMPARE(int(solver.solve(state).status), int(Solver::Status::Unsolvable));
+  BoardState deal(Layout::turtle());
+  Rng rng(2);
+  deal.deal(rng);
+  const Solver::Result result = solver.solve(deal);
+  QCOMPARE(int(result.status), int(Solver::Status::Solvable));
+  QVERIFY(result.table.probes > 0);
+}
+
+void TestSolver::testSolvableShuffle() {
+  // Play random moves until stuck, then shuffle back to a solvable position.
+  BoardState state(Layout::turtle());
+  Rng rng(5);
+  state.deal(rng);
+  std::vector<Move> moves;
+  for (;;) {
+    moves.clear();
+    state.appendMoves(&moves);
+    if (moves.empty()) break;
+    const Move& m = moves[rng.bounded(uint32_t(moves.size()))];
+    state.removePair(m.first, m.second);
+  }
+  QVERIFY(!state.isCleared());
+
+  const std::vector<uint8_t> before = state.kinds();
+  std::vector<int32_t> permutation;
+  QVERIFY(state.solvableShuffle(rng, &permutation));
+  Solver solver;
+  QCOMPARE(int(solver.solve(state).status), int(Solver::Status::Solvable));
+  state.permute(permutation, true);
+  QVERIFY(state.kinds() == before);
+
+  // A single stack has no removal order; it still gets a plain shuffle.
+  BoardState stack(Layout("stack", {{0, 0, 0}, {0, 0, 1}}));
+  stack.set(0, TileKind::FirstBamboo);
+  stack.set(1, TileKind::FirstBamboo);
+  QVERIFY(!stack.solvableShuffle(rng));
+  QCOMPARE(stack.remaining(), 2);
+}
+
+void TestSolver::testSolverService() {
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+  SolverService service;
+  service.setBoard(&board);
+  service.setProgressInterval(1000);
+  QSignalSpy progress(&service, &SolverService::progress);
+  QSignalSpy finished(&service, &SolverService::finished);
+
+  board.generateTurtleLayout(2);
+  service.solve();
+  QVERIFY(service.busy());
+  QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 30000);
+  QVERIFY(!service.busy());
+  QCOMPARE(finished[0][0].value<SolverService::Status>(),
+           SolverService::Solvable);
+  QCOMPARE(finished[0][2].value<QList<int>>().size(), 144);
+
+  // Seed 1 takes millions of nodes; a move cancels it and nothing of the
+  // old search arrives afterwards.
+  board.generateTurtleLayout(1);
+  progress.clear();
+  finished.clear();
+  service.solve();
+  QTRY_VERIFY_WITH_TIMEOUT(progress.count() > 0, 30000);
+  QVERIFY(progress.last()[0].toLongLong() > 0);
+  QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+  board.selectTile(moves[0].first->row(), moves[0].first->column());
+  board.selectTile(moves[0].second->row(), moves[0].second->column());
+  QVERIFY(!service.busy());
+  progress.clear();
+  QTest::qWait(200);
+  QCOMPARE(progress.count(), 0);
+  QCOMPARE(finished.count(), 0);
+}
+
+void TestSolver::testSolutionCache() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("solutions.mjsc");
+
+  BoardState state(Layout::turtle());
+  Rng rng(2);
+  state.deal(rng);
+  Solver solver;
+  const Solver::Result solved = solver.solve(state);
+  QCOMPARE(int(solved.status), int(Solver::Status::Solvable));
+
+  // Swapping two seasons gives the same canonical position.
+  BoardState swapped = state;
+  int seasons[2] = {-1, -1};
+  for (int s = 0; s < swapped.size(); ++s) {
+    const int kind = swapped.kind(s);
+    if (kind == TileKind::FirstSeason && seasons[0] < 0) seasons[0] = s;
+    if (kind == TileKind::FirstSeason + 1 && seasons[1] < 0) seasons[1] = s;
+  }
+  swapped.set(seasons[0], TileKind::FirstSeason + 1);
+  swapped.set(seasons[1], TileKind::FirstSeason);
+  QCOMPARE(SolutionCache::key(swapped), SolutionCache::key(state));
+
+  {
+    SolutionCache cache;
+    QVERIFY(cache.open(path));
+    Solver::Result result;
+    QVERIFY(!cache.find(state, &result));
+    QVERIFY(cache.insert(state, solved));
+    QVERIFY(!cache.insert(state, solved));  // Already known
+    Solver::Result unknown;
+    QVERIFY(!cache.insert(crossedStacks(), unknown));
+    QVERIFY(cache.find(swapped, &result));
+    QCOMPARE(int(result.status), int(Solver::Status::Solvable));
+    QCOMPARE(cache.stats().memoryHits, int64_t(1));
+  }
+
+  // A torn record at the end is dropped when the file is opened again.
+  {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write(QByteArray(20, '\x01'));
+  }
+  SolutionCache cache;
+  QVERIFY(cache.open(path));
+  QCOMPARE(cache.count(), qint64(1));
+  Solver::Result result;
+  QVERIFY(cache.find(state, &result));
+  QCOMPARE(cache.stats().diskHits, int64_t(1));
+  QCOMPARE(int(result.solution.size()), 72);
+  QCOMPARE(result.solution[0].first, solved.solution[0].first);
+
+  // Unsolvable results are cached too.
+  QVERIFY(cache.insert(crossedStacks(), solver.solve(crossedStacks())));
+  QVERIFY(cache.find(crossedStacks(), &result));
+  QCOMPARE(int(result.status), int(Solver::Status::Unsolvable));
+  QVERIFY(result.solution.empty());
+
+  // An entry stored for other match classes under the same key (a hash
+  // collision, made here by changing the last record) is a miss, and
+  // storing the position supersedes it.
+  {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    const qint64 classes = file.size() - crossedStacks().size();
+    QVERIFY(file.seek(classes));
+    const char first = file.read(1).at(0);
+    QVERIFY(file.seek(classes));
+    QCOMPARE(file.write(QByteArray(1, char(first + 1))), qint64(1));
+  }
+  SolutionCache collided;
+  QVERIFY(collided.open(path));
+  QVERIFY(!collided.find(crossedStacks(), &result));
+  QCOMPARE(collided.stats().misses, int64_t(1));
+  QVERIFY(collided.insert(crossedStacks(), solver.solve(crossedStacks())));
+  QCOMPARE(collided.count(), qint64(2));
+  SolutionCache reopened;
+  QVERIFY(reopened.open(path));
+  QVERIFY(reopened.find(crossedStacks(), &result));
+  QCOMPARE(int(result.status), int(Solver::Status::Unsolvable));
+}
+
+void TestSolver::testDifficultyRating() {
+  DifficultyRater::Options options;
+  options.playouts = 100;  // Not a multiple of the chunk size
+  options.chunkSize = 16;
+  QThreadPool pool;
+  pool.setMaxThreadCount(3);
+  const DifficultyRater rater(options, &pool);
+
+  std::vector<BoardState> deals;
+  for (quint64 seed = 1; seed <= 4; ++seed) {
+    BoardState state(Layout::turtle());
+    Rng rng(seed);
+    state.deal(rng);
+    deals.push_back(state);
+  }
+  // The same ratings in parallel, on one thread and in a batch.
+  const std::vector<DifficultyRating> batch = rater.rateAll(deals);
+  QCOMPARE(int(batch.size()), 4);
+  for (size_t i = 0; i < deals.size(); ++i) {
+    const DifficultyRating parallel = rater.rate(deals[i]);
+    const DifficultyRating here = rater.rateHere(deals[i]);
+    QCOMPARE(parallel.score, here.score);
+    QCOMPARE(batch[i].score, here.score);
+    QCOMPARE(int(batch[i].status), int(here.status));
+    QVERIFY(here.score >= 0.0 && here.score <= 1.0);
+    QVERIFY(here.difficulty() >= 1);
+  }
+
+  // The last pairs of a solved deal, all open, are easier than the deal.
+  BoardState endgame = deals[1];
+  const Solver::Result solved = Solver().solve(endgame);
+  QCOMPARE(int(solved.status), int(Solver::Status::Solvable));
+  for (size_t i = 0; i + 4 < solved.solution.size(); ++i)
+    endgame.removePair(solved.solution[i].first, solved.solution[i].second);
+  const DifficultyRating easy = rater.rate(endgame);
+  QCOMPARE(easy.randomWinRate, 1.0);
+  QVERIFY(easy.score < batch[1].score);
+
+  const DifficultyRating stuck = rater.rate(crossedStacks());
+  QCOMPARE(int(stuck.status), int(Solver::Status::Unsolvable));
+  QCOMPARE(stuck.score, 1.0);
+  QCOMPARE(int(stuck.difficulty()), 255);
+}
+
+void TestSolver::testBeamAgreesWithExact() {
+  BeamSolver::Options options;
+  options.beamWidth = 64;
+  options.timeBudgetMs = 0;
+  BeamSolver beam(options);
+  Solver exact;
+  for (quint64 seed : {2, 3, 6, 8}) {
+    BoardState state(Layout::turtle());
+    Rng rng(seed);
+    state.deal(rng);
+    QCOMPARE(int(exact.solve(state).status), int(Solver::Status::Solvable));
+
+    Solver::Result result = beam.solve(state);
+    QCOMPARE(int(result.status), int(Solver::Status::Solvable));
+    QCOMPARE(int(result.solution.size()), 72);
+    for (const Move& m : result.solution) {
+      QVERIFY(state.canRemove(m.first, m.second));
+      state.removePair(m.first, m.second);
+    }
+    QVERIFY(state.isCleared());
+  }
+}
+
+void TestSolver::testBeamProvesUnsolvableWhenExhaustive() {
+  // Nothing is cut from a beam this wide, so a failure is a proof.
+  BeamSolver beam;
+  Solver::Result result = beam.solve(crossedStacks());
+  QCOMPARE(int(result.status), int(Solver::Status::Unsolvable));
+  QVERIFY(result.solution.empty());
+}
+
+void TestSolver::testBeamMemoryBudget() {
+  BoardState state(Layout::turtle());
+  Rng rng(2);
+  state.deal(rng);
+
+  BeamSolver::Options options;
+  options.beamWidth = 1000;
+  options.memoryBudget = int64_t(1) << 20;
+  const int width = BeamSolver(options).beamWidth(state);
+  QVERIFY(width > 0 && width < 1000);
+
+  options.memoryBudget = 1;
+  QCOMPARE(BeamSolver(options).beamWidth(state), 1);
+  options.timeBudgetMs = 0;
+  Solver::Result result = BeamSolver(options).solve(state);
+  QVERIFY(result.status != Solver::Status::Unsolvable);
+}
+
+void TestSolver::testVerifyDealDatabase() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const Layout turtle = Layout::turtle();
+  DealDatabaseWriter writer;
+  QVERIFY(writer.open(dir.filePath("deals.mjdd"), turtle, 1));
+  for (uint64_t seed = 1; seed <= 3; ++seed) {
+    Rng rng(seed);
+    QVERIFY(writer.append(BoardState::dealKinds(turtle.size(), rng),
+                          Solvability::Unknown, 0));
+  }
+  QVERIFY(writer.finish());
+
+  // Without --first, a database is verified from index 0.
+  VerifyOptions opt;
+  opt.dealsPath = dir.filePath("deals.mjdd");
+  opt.outputPath = dir.filePath("deals.csv");
+  opt.nodeLimit = 1000;
+  opt.tableBytes = int64_t(1) << 20;
+  QString summary;
+  QTextStream err(&summary);
+  QVERIFY(verifyDeals(err, opt));
+
+  QFile csv(opt.outputPath);
+  QVERIFY(csv.open(QIODevice::ReadOnly | QIODevice::Text));
+  const QList<QByteArray> lines = csv.readAll().trimmed().split('\n');
+  QCOMPARE(lines.size(), 4);
+  for (int i = 0; i < 3; ++i)
+    QCOMPARE(lines[i + 1].split(',').first(), QByteArray::number(i));
+
+  opt.firstIndex = 2;
+  QVERIFY(verifyDeals(err, opt));
+  csv.close();
+  QVERIFY(csv.open(QIODevice::ReadOnly | QIODevice::Text));
+  const QList<QByteArray> rest = csv.readAll().trimmed().split('\n');
+  QCOMPARE(rest.size(), 2);
+  QCOMPARE(rest[1].split(',').first(), QByteArray("2"));
+}
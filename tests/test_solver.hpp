@@ -0,0 +1,25 @@
+#ifndef TEST_SOLVER_HPP
+#define TEST_SOLVER_HPP
+
+#include <QObject>
+
+class TestSolver : public QObject {
+  Q_OBJECT
+ private slots:
+  void testSolvesDeal();
+  void testProvesUnsolvable();
+  void testNodeLimit();
+  void testReductionsKeepAnswers();
+  void testMoveOrdering();
+  void testTranspositionTable();
+  void testSolvableShuffle();
+  void testSolverService();
+  void testSolutionCache();
+  void testDifficultyRating();
+  void testBeamAgreesWithExact();
+  void testBeamProvesUnsolvableWhenExhaustive();
+  void testBeamMemoryBudget();
+  void testVerifyDealDatabase();
+};
+
+#endif  // TEST_SOLVER_HPP
@@ -2,23 +2,48 @@ TEMPLATE = app
 CONFIG += c++17 console testcase
 CONFIG -= app_bundle    # Add this line
 
-QT += testlib multimedia
+QT += testlib multimedia network
 
 TARGET = tests
 
 HEADERS += \
+    ../src/beamsolver.hpp \
     ../src/board.hpp \
+    ../src/boardsnapshot.hpp \
+    ../src/boardstate.hpp \
+    ../src/dealdatabase.hpp \
+    ../src/difficulty.hpp \
+    ../src/layout.hpp \
+    ../src/layoutloader.hpp \
+    ../src/memoryreport.hpp \
+    ../src/replayarchive.hpp \
+    ../src/replaylog.hpp \
+    ../src/rng.hpp \
+    ../src/savegame.hpp \
+    ../src/solutioncache.hpp \
+    ../src/solver.hpp \
+    ../src/solverservice.hpp \
+    ../src/telemetry.hpp \
     ../src/tile.hpp \
+    ../src/tilekind.hpp \
     ../src/tilemodel.hpp \
+    ../src/transpositiontable.hpp \
+    ../src/undohistory.hpp \
+    ../src/winestimator.hpp \
+    ../tools/verify.hpp \
     test_board.hpp \
+    test_layout.hpp \
+    test_solver.hpp \
     test_tile.hpp
 
 SOURCES += \
     main.cpp \
     test_board.cpp \
+    test_layout.cpp \
+    test_solver.cpp \
     test_tile.cpp \
     ../src/board.cpp \
     ../src/tile.cpp \
     ../src/tilemodel.cpp
 
-INCLUDEPATH += ../src
+INCLUDEPATH += ../src ../tools
@@ -0,0 +1,155 @@
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThreadPool>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "layout.hpp"
+#include "replayarchive.hpp"
+#include "replaylog.hpp"
+
+/**
+ * @file archive.hpp
+ * @brief Packing replay logs into archives and reading them back.
+ */
+
+// Reads the records of a replay log, dropping a cut-off last record.
+inline bool readReplayLog(const QString& path,
+                          std::vector<ReplayFormat::Record>* records) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  ReplayFormat::FileHeader header;
+  if (file.read(reinterpret_cast<char*>(&header), sizeof header) !=
+          qint64(sizeof header) ||
+      header.magic != ReplayFormat::Magic ||
+      header.version != ReplayFormat::Version)
+    return false;
+  const QByteArray bytes = file.readAll();
+  records->resize(size_t(bytes.size()) / sizeof(ReplayFormat::Record));
+  std::memcpy(records->data(), bytes.constData(),
+              records->size() * sizeof(ReplayFormat::Record));
+  return true;
+}
+
+inline bool packArchive(QTextStream& out, const QStringList& logs,
+                        const QString& path) {
+  ReplayArchiveWriter writer;
+  if (!writer.open(path)) {
+    out << "Cannot write " << path << Qt::endl;
+    return false;
+  }
+  qint64 inputBytes = 0;
+  for (const QString& log : logs) {
+    std::vector<ReplayFormat::Record> records;
+    if (!readReplayLog(log, &records)) {
+      out << "Not a replay log: " << log << Qt::endl;
+      return false;
+    }
+    inputBytes += qint64(records.size() * sizeof(ReplayFormat::Record));
+    if (!writer.addLog(records.data(), records.data() + records.size())) {
+      out << "Write failed" << Qt::endl;
+      return false;
+    }
+  }
+  if (!writer.finish()) {
+    out << "Write failed" << Qt::endl;
+    return false;
+  }
+  out << "Packed " << writer.gameCount() << " games, " << inputBytes
+      << " bytes of records into " << QFile(path).size() << " bytes"
+      << Qt::endl;
+  return true;
+}
+
+inline bool printArchiveInfo(QTextStream& out, const ReplayArchive& archive,
+                             const QString& path) {
+  qint64 records = 0;
+  qint64 compressed = 0;
+  for (int i = 0; i < archive.blockCount(); ++i) {
+    records += archive.block(i).recordCount;
+    compressed += archive.block(i).compressedSize;
+  }
+  qint64 seeded = 0;
+  for (qint64 g = 0; g < archive.gameCount(); ++g)
+    seeded += (archive.game(g).flags & ArchiveFormat::Seeded) ? 1 : 0;
+
+  out << "file        " << path << Qt::endl
+      << "games       " << archive.gameCount() << "  (" << seeded
+      << " seeded)" << Qt::endl
+      << "blocks      " << archive.blockCount() << Qt::endl
+      << "records     " << records << Qt::endl
+      << "ratio       "
+      << QString::number(compressed ? double(records) * 16 / compressed : 0,
+                         'f', 2)
+      << Qt::endl;
+  return true;
+}
+
+// Writes one game as a standalone replay log.
+inline bool extractGame(QTextStream& out, const ReplayArchive& archive,
+                        qint64 id, const QString& path) {
+  if (id < 0 || id >= archive.gameCount()) {
+    out << "No such game" << Qt::endl;
+    return false;
+  }
+  const std::vector<ReplayFormat::Record> records = archive.gameRecords(id);
+  QFile file(path);
+  const ReplayFormat::FileHeader header = {ReplayFormat::Magic,
+                                           ReplayFormat::Version, 0};
+  if (records.empty() || !file.open(QIODevice::WriteOnly) ||
+      file.write(reinterpret_cast<const char*>(&header), sizeof header) !=
+          qint64(sizeof header) ||
+      file.write(reinterpret_cast<const char*>(records.data()),
+                 qint64(records.size() * sizeof(ReplayFormat::Record))) < 0) {
+    out << "Cannot extract game " << id << Qt::endl;
+    return false;
+  }
+  out << "Wrote game " << id << " (" << records.size() << " records) to "
+      << path << Qt::endl;
+  return true;
+}
+
+// Replays every game, one block per task on a thread pool.
+inline bool replayArchive(QTextStream& out, const ReplayArchive& archive,
+                          const Layout& layout, int threads) {
+  std::atomic<qint64> games(0), moves(0), records(0), failed(0);
+  QElapsedTimer timer;
+  timer.start();
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  for (int b = 0; b < archive.blockCount(); ++b) {
+    pool.start([&, b]() {
+      const std::vector<ReplayFormat::Record> block = archive.blockRecords(b);
+      if (block.empty()) {
+        failed++;
+        return;
+      }
+      ArchiveFormat::forEachGame(
+          block.data(), block.data() + block.size(),
+          [&](const ReplayFormat::Record* begin,
+              const ReplayFormat::Record* end) {
+            Replayer replayer(layout);
+            if (replayer.apply(begin, end) != end - begin) failed++;
+            games += replayer.games();
+            moves += replayer.moves();
+          });
+      records += qint64(block.size());
+    });
+  }
+  pool.waitForDone();
+
+  const double seconds = qMax(timer.nsecsElapsed(), qint64(1)) / 1e9;
+  out << "games       " << games.load() << Qt::endl
+      << "moves       " << moves.load() << Qt::endl
+      << "failed      " << failed.load() << Qt::endl
+      << "records/s   " << qint64(records.load() / seconds) << Qt::endl;
+  return failed == 0;
+}
+
+#endif  // ARCHIVE_HPP
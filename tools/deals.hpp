@@ -0,0 +1,114 @@
+#ifndef DEALS_HPP
+#define DEALS_HPP
+
+#include <QTextStream>
+#include <vector>
+
+#include "board.hpp"
+#include "dealdatabase.hpp"
+#include "difficulty.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+
+/**
+ * @file deals.hpp
+ * @brief Creating and inspecting deal databases.
+ *
+ * Deal i of a generated database is exactly the deal Board makes for seed
+ * (first seed + i), so a database can always be rebuilt from its seeds.
+ * With a DifficultyRater the deals are rated in batches on its pool, and
+ * their difficulty and, where the rating decided it, solvability are
+ * stored.
+ */
+
+inline bool generateDeals(QTextStream& out, const QString& path,
+                          quint64 firstSeed, qint64 count,
+                          const DifficultyRater* rater = nullptr) {
+  constexpr qint64 BatchSize = 1024;
+  const Layout turtle = Layout::turtle();
+  DealDatabaseWriter writer;
+  if (!writer.open(path, turtle, firstSeed)) {
+    out << "Cannot write " << path << Qt::endl;
+    return false;
+  }
+
+  std::vector<std::vector<uint8_t>> kinds;
+  std::vector<BoardState> states;
+  for (qint64 begin = 0; begin < count; begin += BatchSize) {
+    const qint64 end = qMin(count, begin + BatchSize);
+    kinds.clear();
+    states.clear();
+    for (qint64 i = begin; i < end; ++i) {
+      Rng rng(firstSeed + quint64(i));
+      kinds.push_back(Board::dealKinds(turtle.size(), rng));
+      if (!rater) continue;
+      BoardState state(turtle);
+      for (int s = 0; s < turtle.size(); ++s) state.set(s, kinds.back()[s]);
+      states.push_back(state);
+    }
+    const std::vector<DifficultyRating> ratings =
+        rater ? rater->rateAll(states) : std::vector<DifficultyRating>();
+
+    for (size_t d = 0; d < kinds.size(); ++d) {
+      Solvability solvability = Solvability::Unknown;
+      uint8_t difficulty = 0;
+      if (rater) {
+        if (ratings[d].status == Solver::Status::Solvable)
+          solvability = Solvability::Solvable;
+        else if (ratings[d].status == Solver::Status::Unsolvable)
+          solvability = Solvability::Unsolvable;
+        difficulty = ratings[d].difficulty();
+      }
+      if (!writer.append(kinds[d], solvability, difficulty)) {
+        out << "Write failed after " << begin + qint64(d) << " deals"
+            << Qt::endl;
+        return false;
+      }
+    }
+  }
+
+  if (!writer.finish()) return false;
+  out << "Wrote " << count << " deals to " << path << Qt::endl;
+  return true;
+}
+
+inline bool printDealInfo(QTextStream& out, const QString& path) {
+  DealDatabase db;
+  QString error;
+  if (!db.open(path, &error)) {
+    out << error << Qt::endl;
+    return false;
+  }
+
+  qint64 counts[3] = {0, 0, 0};
+  qint64 rated = 0;
+  qint64 difficulties[4] = {0, 0, 0, 0};  // Quarters of 1..255
+  for (qint64 i = 0; i < db.count(); ++i) {
+    const Deal d = db.deal(i);
+    counts[int(d.solvability) % 3]++;
+    if (d.difficulty == 0) continue;
+    ++rated;
+    difficulties[(d.difficulty - 1) * 4 / 255]++;
+  }
+
+  out << "deals       " << db.count() << Qt::endl;
+  if (db.count() > 0) {
+    out << "seeds       " << db.seed(0) << " - " << db.seed(db.count() - 1)
+        << Qt::endl;
+  }
+  out << "slots       " << db.slotCount() << Qt::endl
+      << "turtle      " << (db.matches(Layout::turtle()) ? "yes" : "no")
+      << Qt::endl
+      << "solvable    " << counts[int(Solvability::Solvable)] << Qt::endl
+      << "unsolvable  " << counts[int(Solvability::Unsolvable)] << Qt::endl
+      << "unknown     " << counts[int(Solvability::Unknown)] << Qt::endl
+      << "rated       " << rated << Qt::endl;
+  if (rated > 0) {
+    out << "difficulty  " << difficulties[0] << " easy, " << difficulties[1]
+        << " medium, " << difficulties[2] << " hard, " << difficulties[3]
+        << " very hard" << Qt::endl;
+  }
+  return true;
+}
+
+#endif  // DEALS_HPP
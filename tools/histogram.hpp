@@ -0,0 +1,63 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+/**
+ * @file histogram.hpp
+ * @brief Fixed-size latency histogram with power-of-two buckets.
+ *
+ * Bucket i holds durations in [2^i, 2^(i+1)) nanoseconds, so recording is a
+ * single bit scan and histograms from several threads can simply be added
+ * together. Percentiles are reported as the upper bound of the bucket they
+ * fall into.
+ */
+
+class LatencyHistogram {
+ public:
+  static constexpr int Buckets = 48;
+
+  void record(int64_t ns) {
+    if (ns < 1) ns = 1;
+    int bucket = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+    m_counts[std::min(bucket, Buckets - 1)]++;
+    m_count++;
+    m_total += ns;
+    m_max = std::max(m_max, ns);
+  }
+
+  void merge(const LatencyHistogram& other) {
+    for (int i = 0; i < Buckets; ++i) m_counts[i] += other.m_counts[i];
+    m_count += other.m_count;
+    m_total += other.m_total;
+    m_max = std::max(m_max, other.m_max);
+  }
+
+  uint64_t count() const { return m_count; }
+  int64_t max() const { return m_max; }
+  double mean() const { return m_count ? double(m_total) / m_count : 0.0; }
+  uint64_t bucketCount(int i) const { return m_counts[i]; }
+  static int64_t bucketLimit(int i) { return int64_t(1) << (i + 1); }
+
+  // Upper bound of the bucket holding the given quantile (0..1).
+  int64_t percentile(double q) const {
+    if (m_count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * (m_count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < Buckets; ++i) {
+      seen += m_counts[i];
+      if (seen >= rank) return std::min(bucketLimit(i), m_max);
+    }
+    return m_max;
+  }
+
+ private:
+  std::array<uint64_t, Buckets> m_counts{};
+  uint64_t m_count = 0;
+  int64_t m_total = 0;
+  int64_t m_max = 0;
+};
+
+#endif  // HISTOGRAM_HPP
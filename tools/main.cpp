@@ -0,0 +1,328 @@
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QMap>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <functional>
+
+#include "archive.hpp"
+#include "deals.hpp"
+#include "layoutloader.hpp"
+#include "replay.hpp"
+#include "simulate.hpp"
+#include "verify.hpp"
+
+/**
+ * @file main.cpp
+ * @brief Command line tools for the Mahjong engine.
+ *
+ * Usage: mahjong-cli <command> [options]
+ *
+ * Commands:
+ *   simulate   Play many games headlessly and report throughput, win rate
+ *              and per-operation latency.
+ *   memory     Deal a game and print the estimated memory per subsystem.
+ *   deals      Create ("generate", optionally rating every deal) or
+ *              inspect ("info") a deal database.
+ *   replay     Fast-forward through a replay log and report its games.
+ *   verify     Solve deals on all cores and write whether each is solvable.
+ *   archive    Pack replay logs into a compressed archive, or inspect,
+ *              extract from and replay one.
+ *
+ * Run "mahjong-cli <command> --help" for the options of a command.
+ */
+
+namespace {
+
+// Each command parses its own options from the arguments after its name.
+using Command = std::function<int(QStringList)>;
+
+// The layout named by a --layout option, or the turtle if it is empty.
+bool loadLayoutOption(QTextStream& out, const QString& path, Layout* layout) {
+  if (path.isEmpty()) {
+    *layout = Layout::turtle();
+    return true;
+  }
+  QString error;
+  *layout = LayoutLoader().load(path, &error);
+  if (layout->isEmpty()) out << error << Qt::endl;
+  return !layout->isEmpty();
+}
+
+int simulateCommand(QStringList args) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Headless random-play simulator");
+  parser.addHelpOption();
+  QCommandLineOption gamesOpt("games", "Number of games.", "N", "10000");
+  QCommandLineOption threadsOpt(
+      "threads", "Worker threads (default: one per core).", "N",
+      QString::number(QThread::idealThreadCount()));
+  QCommandLineOption seedOpt("seed", "Seed of the run.", "N", "1");
+  QCommandLineOption strategyOpt("strategy", "random or greedy.", "name",
+                                 "random");
+  QCommandLineOption shufflesOpt("max-shuffles",
+                                 "Shuffles allowed before a game is lost.",
+                                 "N", "10");
+  QCommandLineOption slotsOpt("slots", "Play a synthetic layout of N slots.",
+                              "N", "0");
+  QCommandLineOption layersOpt("layers", "Layers of the synthetic layout.",
+                               "N", "5");
+  QCommandLineOption histogramOpt("histogram",
+                                  "Print full latency histograms.");
+  parser.addOptions({gamesOpt, threadsOpt, seedOpt, strategyOpt, shufflesOpt,
+                     slotsOpt, layersOpt, histogramOpt});
+  parser.process(args);
+
+  SimulationOptions opt;
+  opt.games = parser.value(gamesOpt).toLongLong();
+  opt.threads = qMax(1, parser.value(threadsOpt).toInt());
+  opt.seed = parser.value(seedOpt).toULongLong();
+  opt.strategy = parser.value(strategyOpt) == "greedy" ? Strategy::Greedy
+                                                        : Strategy::Random;
+  opt.maxShuffles = parser.value(shufflesOpt).toInt();
+  opt.slots = parser.value(slotsOpt).toInt();
+  opt.layers = parser.value(layersOpt).toInt();
+
+  QTextStream out(stdout);
+  runSimulation(out, opt, parser.isSet(histogramOpt));
+  return 0;
+}
+
+int memoryCommand(QStringList args) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Memory footprint report");
+  parser.addHelpOption();
+  QCommandLineOption slotsOpt("slots", "Deal a synthetic layout of N slots.",
+                              "N", "0");
+  QCommandLineOption layersOpt("layers", "Layers of the synthetic layout.",
+                               "N", "5");
+  QCommandLineOption shufflesOpt("shuffles",
+                                 "Shuffle N times before the report.", "N",
+                                 "0");
+  parser.addOptions({slotsOpt, layersOpt, shufflesOpt});
+  parser.process(args);
+
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+
+  int slots = parser.value(slotsOpt).toInt();
+  board.generateLayout(slots > 0 ? Layout::synthetic(
+                                       slots, parser.value(layersOpt).toInt())
+                                 : Layout::turtle());
+  for (int i = 0; i < parser.value(shufflesOpt).toInt(); ++i) board.shuffle();
+
+  QTextStream out(stdout);
+  out << board.memoryReportText();
+  return 0;
+}
+
+int dealsCommand(QStringList args) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Deal database tool");
+  parser.addHelpOption();
+  parser.addPositionalArgument("action", "generate or info");
+  parser.addPositionalArgument("file", "Deal database file.");
+  QCommandLineOption countOpt("count", "Deals to generate.", "N", "1000000");
+  QCommandLineOption seedOpt("seed", "Seed of the first deal.", "N", "1");
+  QCommandLineOption rateOpt(
+      "rate", "Rate the difficulty and solvability of every deal.");
+  QCommandLineOption threadsOpt(
+      "threads", "Worker threads for --rate (default: one per core).", "N",
+      QString::number(QThread::idealThreadCount()));
+  parser.addOptions({countOpt, seedOpt, rateOpt, threadsOpt});
+  parser.process(args);
+
+  QTextStream out(stdout);
+  const QStringList pos = parser.positionalArguments();
+  if (pos.size() != 2) parser.showHelp(2);
+
+  if (pos[0] == "generate") {
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, parser.value(threadsOpt).toInt()));
+    const DifficultyRater rater(DifficultyRater::Options(), &pool);
+    return generateDeals(out, pos[1], parser.value(seedOpt).toULongLong(),
+                         parser.value(countOpt).toLongLong(),
+                         parser.isSet(rateOpt) ? &rater : nullptr)
+               ? 0
+               : 1;
+  }
+  if (pos[0] == "info") return printDealInfo(out, pos[1]) ? 0 : 1;
+  parser.showHelp(2);
+}
+
+int replayCommand(QStringList args) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Replay log tool");
+  parser.addHelpOption();
+  parser.addPositionalArgument("file", "Replay log file.");
+  QCommandLineOption layoutOpt(
+      "layout", "KMahjongg layout the games were played on (default: turtle).",
+      "file");
+  parser.addOption(layoutOpt);
+  parser.process(args);
+
+  QTextStream out(stdout);
+  const QStringList pos = parser.positionalArguments();
+  if (pos.size() != 1) parser.showHelp(2);
+
+  Layout layout;
+  if (!loadLayoutOption(out, parser.value(layoutOpt), &layout)) return 1;
+  return replayLog(out, pos[0], layout) ? 0 : 1;
+}
+
+int verifyCommand(QStringList args) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Batch deal verification");
+  parser.addHelpOption();
+  QCommandLineOption firstOpt(
+      "first",
+      "First seed (default: 1), or first index with --deals (default: 0).",
+      "N");
+  QCommandLineOption countOpt("count", "Deals to verify.", "N", "1000");
+  QCommandLineOption dealsOpt("deals", "Verify deals from a deal database.",
+                              "file");
+  QCommandLineOption outputOpt("output", "Result file (default: stdout).",
+                               "file");
+  QCommandLineOption binaryOpt("binary", "Write binary records, not CSV.");
+  QCommandLineOption threadsOpt(
+      "threads", "Worker threads (default: one per core).", "N",
+      QString::number(QThread::idealThreadCount()));
+  QCommandLineOption limitOpt(
+      "node-limit", "Give up on a deal after N nodes.", "N",
+      QString::number(Solver::Options().nodeLimit));
+  QCommandLineOption tableOpt(
+      "table-mb", "Transposition table size per thread, in MiB.", "N",
+      QString::number(Solver::Options().tableBytes >> 20));
+  QCommandLineOption noSafeOpt(
+      "no-safe-moves", "Branch on every pair, even when one is safe.");
+  QCommandLineOption noSleepOpt(
+      "no-sleep-sets", "Try reorderings of failed moves again.");
+  QCommandLineOption beamOpt(
+      "beam", "Also run the beam solver and report how often it agrees.");
+  QCommandLineOption beamWidthOpt(
+      "beam-width", "Positions kept per level by the beam solver.", "N",
+      QString::number(BeamSolver::Options().beamWidth));
+  QCommandLineOption beamTimeOpt(
+      "beam-ms", "Time budget of the beam solver per deal (0: none).", "ms",
+      QString::number(BeamSolver::Options().timeBudgetMs));
+  parser.addOptions({firstOpt, countOpt, dealsOpt, outputOpt, binaryOpt,
+                     threadsOpt, limitOpt, tableOpt, noSafeOpt, noSleepOpt,
+                     beamOpt, beamWidthOpt, beamTimeOpt});
+  parser.process(args);
+
+  VerifyOptions opt;
+  opt.count = parser.value(countOpt).toLongLong();
+  opt.dealsPath = parser.value(dealsOpt);
+  if (parser.isSet(firstOpt)) {
+    if (opt.dealsPath.isEmpty())
+      opt.first = parser.value(firstOpt).toULongLong();
+    else
+      opt.firstIndex = parser.value(firstOpt).toLongLong();
+  }
+  opt.outputPath = parser.value(outputOpt);
+  opt.binary = parser.isSet(binaryOpt);
+  opt.threads = qMax(1, parser.value(threadsOpt).toInt());
+  opt.nodeLimit = parser.value(limitOpt).toLongLong();
+  opt.tableBytes = parser.value(tableOpt).toLongLong() << 20;
+  opt.safeMoves = !parser.isSet(noSafeOpt);
+  opt.sleepSets = !parser.isSet(noSleepOpt);
+  opt.beam = parser.isSet(beamOpt);
+  opt.beamOptions.beamWidth = qMax(1, parser.value(beamWidthOpt).toInt());
+  opt.beamOptions.timeBudgetMs = parser.value(beamTimeOpt).toLongLong();
+
+  QTextStream err(stderr);
+  return verifyDeals(err, opt) ? 0 : 1;
+}
+
+int archiveCommand(QStringList args) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Replay archive tool");
+  parser.addHelpOption();
+  parser.addPositionalArgument("action", "pack, info, extract or replay");
+  parser.addPositionalArgument("archive", "Replay archive file.");
+  parser.addPositionalArgument("files", "pack: replay logs; extract: output.",
+                               "[files...]");
+  QCommandLineOption gameOpt("game", "extract: game id.", "N");
+  QCommandLineOption seedOpt("seed", "extract: first game dealt from seed.",
+                             "N");
+  QCommandLineOption layoutOpt(
+      "layout", "replay: layout the games were played on (default: turtle).",
+      "file");
+  QCommandLineOption threadsOpt(
+      "threads", "replay: worker threads (default: one per core).", "N",
+      QString::number(QThread::idealThreadCount()));
+  parser.addOptions({gameOpt, seedOpt, layoutOpt, threadsOpt});
+  parser.process(args);
+
+  QTextStream out(stdout);
+  QStringList pos = parser.positionalArguments();
+  if (pos.size() < 2) parser.showHelp(2);
+  const QString action = pos.takeFirst();
+  const QString path = pos.takeFirst();
+
+  if (action == "pack") {
+    if (pos.isEmpty()) parser.showHelp(2);
+    return packArchive(out, pos, path) ? 0 : 1;
+  }
+
+  ReplayArchive archive;
+  QString error;
+  if (!archive.open(path, &error)) {
+    out << error << Qt::endl;
+    return 1;
+  }
+  if (action == "info") return printArchiveInfo(out, archive, path) ? 0 : 1;
+  if (action == "extract") {
+    if (pos.size() != 1 || parser.isSet(gameOpt) == parser.isSet(seedOpt))
+      parser.showHelp(2);
+    const qint64 id =
+        parser.isSet(gameOpt)
+            ? parser.value(gameOpt).toLongLong()
+            : archive.findSeed(parser.value(seedOpt).toULongLong());
+    return extractGame(out, archive, id, pos[0]) ? 0 : 1;
+  }
+  if (action == "replay") {
+    Layout layout;
+    if (!loadLayoutOption(out, parser.value(layoutOpt), &layout)) return 1;
+    return replayArchive(out, archive, layout,
+                         qMax(1, parser.value(threadsOpt).toInt()))
+               ? 0
+               : 1;
+  }
+  parser.showHelp(2);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // Board plays sounds through Qt Multimedia, which wants a GUI
+  // application; nothing is ever shown.
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QGuiApplication app(argc, argv);
+  QCoreApplication::setApplicationName("mahjong-cli");
+
+  const QMap<QString, Command> commands = {
+      {"simulate", simulateCommand},
+      {"memory", memoryCommand},
+      {"deals", dealsCommand},
+      {"replay", replayCommand},
+      {"verify", verifyCommand},
+      {"archive", archiveCommand},
+  };
+
+  QStringList args = app.arguments();
+  QTextStream err(stderr);
+  if (args.size() < 2 || !commands.contains(args[1])) {
+    err << "Usage: mahjong-cli <command> [options]" << Qt::endl
+        << "Commands: " << QStringList(commands.keys()).join(", ")
+        << Qt::endl;
+    return 2;
+  }
+
+  // Drop the command name so the command sees "program [options]".
+  QString name = args.takeAt(1);
+  return commands[name](args);
+}
@@ -0,0 +1,78 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "layout.hpp"
+#include "replaylog.hpp"
+
+/**
+ * @file replay.hpp
+ * @brief Fast-forwarding through replay logs.
+ *
+ * The log is memory-mapped and its records are applied to a Replayer in
+ * place, so the rate is bounded by the game rules rather than by parsing.
+ */
+
+inline bool replayLog(QTextStream& out, const QString& path,
+                      const Layout& layout) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    out << "Cannot open " << path << Qt::endl;
+    return false;
+  }
+  const qint64 headerSize = sizeof(ReplayFormat::FileHeader);
+  if (file.size() < headerSize) {
+    out << "Not a replay log" << Qt::endl;
+    return false;
+  }
+  const uchar* data = file.map(0, file.size());
+  if (!data) {
+    out << "Cannot map " << path << Qt::endl;
+    return false;
+  }
+
+  ReplayFormat::FileHeader header;
+  std::memcpy(&header, data, sizeof header);
+  if (header.magic != ReplayFormat::Magic ||
+      header.version != ReplayFormat::Version) {
+    out << "Not a replay log" << Qt::endl;
+    return false;
+  }
+
+  const auto* begin =
+      reinterpret_cast<const ReplayFormat::Record*>(data + headerSize);
+  const auto* end =
+      begin + (file.size() - headerSize) / qint64(sizeof(ReplayFormat::Record));
+
+  // A log may hold games on other layouts; replay resumes at the next game
+  // after a record that does not fit.
+  Replayer replayer(layout);
+  qint64 applied = 0;
+  qint64 skipped = 0;
+  QElapsedTimer timer;
+  timer.start();
+  for (const ReplayFormat::Record* r = begin; r != end;) {
+    const int64_t n = replayer.apply(r, end);
+    applied += n;
+    r += n;
+    if (r == end) break;
+    do {
+      ++r;
+      ++skipped;
+    } while (r != end && r->type != ReplayFormat::NewGame);
+  }
+  const double seconds = qMax(timer.nsecsElapsed(), qint64(1)) / 1e9;
+
+  out << "records     " << (end - begin) << Qt::endl
+      << "skipped     " << skipped << Qt::endl
+      << "games       " << replayer.games() << Qt::endl
+      << "moves       " << replayer.moves() << Qt::endl
+      << "records/s   " << qint64(applied / seconds) << Qt::endl
+      << "tiles left  " << replayer.state().remaining() << Qt::endl;
+  return true;
+}
+
+#endif  // REPLAY_HPP
@@ -0,0 +1,227 @@
+#ifndef SIMULATE_HPP
+#define SIMULATE_HPP
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+
+#include "board.hpp"
+#include "histogram.hpp"
+#include "rng.hpp"
+#include "tilemodel.hpp"
+
+/**
+ * @file simulate.hpp
+ * @brief Headless self-play through the real Board rules.
+ *
+ * Every worker thread owns its own TileModel and Board and plays complete
+ * games: deal, pick a matching pair (randomly or greedily) and select both
+ * tiles, shuffle when no pair is left, until the board is cleared or the
+ * shuffle allowance is used up. Games are numbered and game i is always
+ * dealt with the same seed, so any game from a run can be replayed.
+ */
+
+enum class Strategy { Random, Greedy };
+
+struct SimulationOptions {
+  qint64 games = 10000;
+  int threads = 1;
+  quint64 seed = 1;
+  Strategy strategy = Strategy::Random;
+  int maxShuffles = 10;
+  int slots = 0;  // 0 selects the turtle, otherwise a synthetic layout
+  int layers = 5;
+};
+
+struct SimulationStats {
+  qint64 games = 0;
+  qint64 wins = 0;
+  qint64 moves = 0;
+  qint64 shuffles = 0;
+  LatencyHistogram generate;
+  LatencyHistogram move;
+  LatencyHistogram shuffle;
+
+  void merge(const SimulationStats& o) {
+    games += o.games;
+    wins += o.wins;
+    moves += o.moves;
+    shuffles += o.shuffles;
+    generate.merge(o.generate);
+    move.merge(o.move);
+    shuffle.merge(o.shuffle);
+  }
+};
+
+inline quint64 gameSeed(quint64 runSeed, qint64 game) {
+  Rng seeder(runSeed + static_cast<quint64>(game));
+  return seeder();
+}
+
+// Greedy play removes the highest pair first, since tiles on top are the
+// ones blocking the most others.
+inline int pickMove(const QVector<QPair<Tile*, Tile*>>& moves,
+                    Strategy strategy, Rng& rng) {
+  if (strategy == Strategy::Random)
+    return rng.bounded(static_cast<uint32_t>(moves.size()));
+
+  int best = 0;
+  int bestScore = -1;
+  for (int i = 0; i < moves.size(); ++i) {
+    int score = moves[i].first->layer() + moves[i].second->layer();
+    if (score > bestScore) {
+      bestScore = score;
+      best = i;
+    }
+  }
+  return best;
+}
+
+inline SimulationStats simulateWorker(const SimulationOptions& opt,
+                                      int worker) {
+  TileModel model;
+  Board board(&model);
+  board.setSoundsEnabled(false);
+
+  const Layout layout = opt.slots > 0
+                            ? Layout::synthetic(opt.slots, opt.layers)
+                            : Layout::turtle();
+
+  SimulationStats stats;
+  QElapsedTimer timer;
+
+  for (qint64 game = worker; game < opt.games; game += opt.threads) {
+    quint64 seed = gameSeed(opt.seed, game);
+    Rng choice(~seed);
+
+    timer.start();
+    board.generateLayout(layout, seed);
+    stats.generate.record(timer.nsecsElapsed());
+
+    int shuffles = 0;
+    while (model.rowCount() > 0) {
+      QVector<QPair<Tile*, Tile*>> moves = board.availableMoves();
+      if (moves.isEmpty()) {
+        if (shuffles == opt.maxShuffles) break;
+        timer.restart();
+        board.shuffle();
+        stats.shuffle.record(timer.nsecsElapsed());
+        ++shuffles;
+        continue;
+      }
+
+      const auto& pair = moves[pickMove(moves, opt.strategy, choice)];
+      int r1 = pair.first->row(), c1 = pair.first->column();
+      int r2 = pair.second->row(), c2 = pair.second->column();
+
+      timer.restart();
+      board.selectTile(r1, c1);
+      board.selectTile(r2, c2);
+      stats.move.record(timer.nsecsElapsed());
+      ++stats.moves;
+    }
+
+    ++stats.games;
+    stats.shuffles += shuffles;
+    if (model.rowCount() == 0) ++stats.wins;
+  }
+  return stats;
+}
+
+inline void printLatency(QTextStream& out, const QString& name,
+                         const LatencyHistogram& h) {
+  out << QString("  %1 %2 %3 %4 %5 %6 %7")
+             .arg(name, -10)
+             .arg(h.count(), 12)
+             .arg(h.mean(), 10, 'f', 0)
+             .arg(h.percentile(0.50), 10)
+             .arg(h.percentile(0.90), 10)
+             .arg(h.percentile(0.99), 10)
+             .arg(h.max(), 10)
+      << Qt::endl;
+}
+
+inline void printHistogram(QTextStream& out, const QString& name,
+                           const LatencyHistogram& h) {
+  out << name << " latency histogram (ns):" << Qt::endl;
+  for (int i = 0; i < LatencyHistogram::Buckets; ++i) {
+    if (h.bucketCount(i) == 0) continue;
+    out << QString("  < %1  %2  %3%")
+               .arg(LatencyHistogram::bucketLimit(i), 12)
+               .arg(h.bucketCount(i), 12)
+               .arg(100.0 * h.bucketCount(i) / h.count(), 6, 'f', 2)
+        << Qt::endl;
+  }
+}
+
+inline SimulationStats runSimulation(QTextStream& out,
+                                     const SimulationOptions& opt,
+                                     bool histograms) {
+  SimulationStats total;
+  QMutex mutex;
+
+  QElapsedTimer wall;
+  wall.start();
+
+  QVector<QThread*> threads;
+  for (int w = 0; w < opt.threads; ++w) {
+    threads.append(QThread::create([&, w]() {
+      SimulationStats stats = simulateWorker(opt, w);
+      QMutexLocker lock(&mutex);
+      total.merge(stats);
+    }));
+    threads.last()->start();
+  }
+  for (QThread* t : threads) {
+    t->wait();
+    delete t;
+  }
+
+  double seconds = wall.nsecsElapsed() / 1e9;
+  out << QString("games    %1  (%2 games/s)")
+             .arg(total.games, 12)
+             .arg(total.games / seconds, 0, 'f', 1)
+      << Qt::endl;
+  out << QString("moves    %1  (%2 moves/s)")
+             .arg(total.moves, 12)
+             .arg(total.moves / seconds, 0, 'f', 1)
+      << Qt::endl;
+  out << QString("wins     %1  (%2%)")
+             .arg(total.wins, 12)
+             .arg(total.games ? 100.0 * total.wins / total.games : 0.0, 0,
+                  'f', 2)
+      << Qt::endl;
+  out << QString("shuffles %1  (%2 per game)")
+             .arg(total.shuffles, 12)
+             .arg(total.games ? double(total.shuffles) / total.games : 0.0,
+                  0, 'f', 2)
+      << Qt::endl;
+  out << QString("threads  %1, %2 s").arg(opt.threads).arg(seconds, 0, 'f', 2)
+      << Qt::endl
+      << Qt::endl;
+
+  out << QString("  %1 %2 %3 %4 %5 %6 %7")
+             .arg("ns", -10)
+             .arg("count", 12)
+             .arg("mean", 10)
+             .arg("p50", 10)
+             .arg("p90", 10)
+             .arg("p99", 10)
+             .arg("max", 10)
+      << Qt::endl;
+  printLatency(out, "generate", total.generate);
+  printLatency(out, "move", total.move);
+  printLatency(out, "shuffle", total.shuffle);
+
+  if (histograms) {
+    out << Qt::endl;
+    printHistogram(out, "generate", total.generate);
+    printHistogram(out, "move", total.move);
+    printHistogram(out, "shuffle", total.shuffle);
+  }
+  return total;
+}
+
+#endif  // SIMULATE_HPP
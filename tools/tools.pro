@@ -0,0 +1,43 @@
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+QT += multimedia network
+
+TARGET = mahjong-cli
+
+HEADERS += \
+    ../src/beamsolver.hpp \
+    ../src/board.hpp \
+    ../src/boardsnapshot.hpp \
+    ../src/boardstate.hpp \
+    ../src/dealdatabase.hpp \
+    ../src/difficulty.hpp \
+    ../src/layout.hpp \
+    ../src/layoutloader.hpp \
+    ../src/memoryreport.hpp \
+    ../src/replayarchive.hpp \
+    ../src/replaylog.hpp \
+    ../src/rng.hpp \
+    ../src/savegame.hpp \
+    ../src/solver.hpp \
+    ../src/telemetry.hpp \
+    ../src/tile.hpp \
+    ../src/tilekind.hpp \
+    ../src/tilemodel.hpp \
+    ../src/transpositiontable.hpp \
+    ../src/undohistory.hpp \
+    ../src/winestimator.hpp \
+    archive.hpp \
+    deals.hpp \
+    histogram.hpp \
+    replay.hpp \
+    simulate.hpp \
+    verify.hpp
+
+SOURCES += \
+    main.cpp
+
+RESOURCES += ../src/resources/resources.qrc
+
+INCLUDEPATH += ../src
@@ -0,0 +1,274 @@
+#ifndef VERIFY_HPP
+#define VERIFY_HPP
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <map>
+#include <vector>
+
+#include "beamsolver.hpp"
+#include "boardstate.hpp"
+#include "dealdatabase.hpp"
+#include "layout.hpp"
+#include "rng.hpp"
+#include "solver.hpp"
+#include "transpositiontable.hpp"
+
+/**
+ * @file verify.hpp
+ * @brief Classifying deals with the exact solver on all cores.
+ *
+ * Deals are cut into chunks that worker threads of a QThreadPool claim one
+ * after the other. The main thread writes finished chunks in deal order;
+ * workers wait when they get too far ahead of the writer, so memory stays
+ * bounded however many deals are verified. Results are written as CSV or
+ * as fixed-size binary records (see VerifyFormat).
+ *
+ * With VerifyOptions::beam every deal also goes through the beam solver,
+ * and the summary tells how often its answer agrees with the exact one.
+ */
+
+namespace VerifyFormat {
+
+constexpr uint32_t Magic = 0x56524a4d;  // "MJRV"
+constexpr uint32_t Version = 2;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+};
+
+// status and beam use the Solvability values of the deal database.
+struct Record {
+  uint64_t deal;  // Seed or deal database index
+  uint64_t nodes;
+  uint32_t micros;
+  uint16_t solutionLength;  // Pairs; 0 unless solvable
+  uint8_t status;
+  uint8_t beam;  // Beam solver's answer, or NoBeam
+};
+
+constexpr uint8_t NoBeam = 0xff;
+
+static_assert(sizeof(Record) == 24, "Verify records are 24 bytes");
+
+}  // namespace VerifyFormat
+
+struct VerifyOptions {
+  quint64 first = 1;  // First seed
+  qint64 firstIndex = 0;  // First index with a deal database
+  qint64 count = 1000;
+  QString dealsPath;  // Empty: deal from seeds like Board does
+  QString outputPath;  // Empty: standard output
+  bool binary = false;
+  int threads = 1;
+  qint64 nodeLimit = Solver::Options().nodeLimit;
+  qint64 tableBytes = Solver::Options().tableBytes;  // Per thread
+  bool safeMoves = true;  // See Solver::Options
+  bool sleepSets = true;
+  int chunkSize = 64;
+  bool beam = false;  // Also run the beam solver and compare
+  BeamSolver::Options beamOptions;
+};
+
+inline Solvability toSolvability(Solver::Status status) {
+  switch (status) {
+    case Solver::Status::Solvable:
+      return Solvability::Solvable;
+    case Solver::Status::Unsolvable:
+      return Solvability::Unsolvable;
+    default:
+      return Solvability::Unknown;
+  }
+}
+
+inline bool verifyDeals(QTextStream& err, const VerifyOptions& opt) {
+  const Layout turtle = Layout::turtle();
+  DealDatabase db;
+  if (!opt.dealsPath.isEmpty()) {
+    QString error;
+    if (!db.open(opt.dealsPath, &error)) {
+      err << error << Qt::endl;
+      return false;
+    }
+    if (!db.matches(turtle)) {
+      err << "The deal database is not for the turtle" << Qt::endl;
+      return false;
+    }
+  }
+  qint64 count = opt.count;
+  quint64 first = opt.first;
+  if (db.isOpen()) {
+    const qint64 index = qMax(qint64(0), opt.firstIndex);
+    count = qMax(qint64(0), qMin(count, db.count() - index));
+    first = quint64(index);
+  }
+
+  QFile out(opt.outputPath);
+  const bool opened = opt.outputPath.isEmpty()
+                          ? out.open(stdout, QIODevice::WriteOnly)
+                          : out.open(QIODevice::WriteOnly);
+  if (!opened) {
+    err << "Cannot write " << opt.outputPath << Qt::endl;
+    return false;
+  }
+  if (opt.binary) {
+    const VerifyFormat::Header header = {VerifyFormat::Magic,
+                                         VerifyFormat::Version};
+    out.write(reinterpret_cast<const char*>(&header), sizeof header);
+  } else {
+    out.write(opt.beam ? "deal,status,nodes,micros,length,beam\n"
+                       : "deal,status,nodes,micros,length\n");
+  }
+
+  auto solveChunk = [&](qint64 chunk, TranspositionTable::Stats* table) {
+    std::vector<VerifyFormat::Record> records;
+    Solver::Options options;
+    options.nodeLimit = opt.nodeLimit;
+    options.tableBytes = opt.tableBytes;
+    options.safeMoves = opt.safeMoves;
+    options.sleepSets = opt.sleepSets;
+    Solver solver(options);
+    BeamSolver beam(opt.beamOptions);
+    QElapsedTimer timer;
+
+    const qint64 begin = chunk * opt.chunkSize;
+    const qint64 end = qMin(count, begin + opt.chunkSize);
+    for (qint64 i = begin; i < end; ++i) {
+      const quint64 deal = first + quint64(i);
+      BoardState state(turtle);
+      if (db.isOpen()) {
+        const uint8_t* kinds = db.deal(qint64(deal)).kinds;
+        for (int s = 0; s < turtle.size(); ++s) {
+          state.set(s, kinds[s] < TileKind::Count ? kinds[s]
+                                                  : int(TileKind::None));
+        }
+      } else {
+        Rng rng(deal);
+        state.deal(rng);
+      }
+
+      timer.start();
+      const Solver::Result result = solver.solve(state);
+      const qint64 micros = timer.nsecsElapsed() / 1000;
+      *table += result.table;
+      const uint8_t beamStatus =
+          opt.beam ? uint8_t(toSolvability(beam.solve(state).status))
+                   : VerifyFormat::NoBeam;
+      records.push_back({deal, uint64_t(result.nodes),
+                         uint32_t(qMin(micros, qint64(UINT32_MAX))),
+                         uint16_t(result.solution.size()),
+                         uint8_t(toSolvability(result.status)), beamStatus});
+    }
+    return records;
+  };
+
+  const qint64 chunks = (count + opt.chunkSize - 1) / opt.chunkSize;
+  const qint64 maxAhead = qint64(opt.threads) * 4;
+  QMutex mutex;
+  QWaitCondition changed;
+  std::map<qint64, std::vector<VerifyFormat::Record>> finished;
+  qint64 claimed = 0;
+  qint64 written = 0;
+  TranspositionTable::Stats table;  // Guarded by mutex
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(opt.threads);
+  QElapsedTimer wall;
+  wall.start();
+  for (int w = 0; w < opt.threads; ++w) {
+    pool.start([&]() {
+      for (;;) {
+        qint64 chunk;
+        {
+          QMutexLocker lock(&mutex);
+          while (claimed < chunks && claimed - written >= maxAhead)
+            changed.wait(&mutex);
+          if (claimed == chunks) return;
+          chunk = claimed++;
+        }
+        TranspositionTable::Stats chunkTable;
+        std::vector<VerifyFormat::Record> records =
+            solveChunk(chunk, &chunkTable);
+        QMutexLocker lock(&mutex);
+        finished[chunk] = std::move(records);
+        table += chunkTable;
+        changed.wakeAll();
+      }
+    });
+  }
+
+  qint64 counts[3] = {0, 0, 0};
+  qint64 nodes = 0;
+  qint64 decided = 0;  // Deals the exact solver decided
+  qint64 agreed = 0;  // ... and the beam solver answered the same
+  qint64 beamSolved = 0;
+  while (written < chunks) {
+    std::vector<VerifyFormat::Record> records;
+    {
+      QMutexLocker lock(&mutex);
+      while (!finished.count(written)) changed.wait(&mutex);
+      records = std::move(finished[written]);
+      finished.erase(written);
+    }
+
+    if (opt.binary) {
+      out.write(reinterpret_cast<const char*>(records.data()),
+                qint64(records.size() * sizeof(VerifyFormat::Record)));
+    } else {
+      QByteArray text;
+      for (const VerifyFormat::Record& r : records) {
+        text += QByteArray::number(quint64(r.deal)) + ',' +
+                QByteArray::number(r.status) + ',' +
+                QByteArray::number(quint64(r.nodes)) + ',' +
+                QByteArray::number(r.micros) + ',' +
+                QByteArray::number(r.solutionLength);
+        if (opt.beam) text += ',' + QByteArray::number(r.beam);
+        text += '\n';
+      }
+      out.write(text);
+    }
+    for (const VerifyFormat::Record& r : records) {
+      counts[r.status % 3]++;
+      nodes += qint64(r.nodes);
+      if (!opt.beam) continue;
+      const bool beamFound = r.beam == uint8_t(Solvability::Solvable);
+      beamSolved += beamFound ? 1 : 0;
+      if (r.status != uint8_t(Solvability::Unknown)) {
+        ++decided;
+        agreed += beamFound == (r.status == uint8_t(Solvability::Solvable));
+      }
+    }
+
+    QMutexLocker lock(&mutex);
+    ++written;
+    changed.wakeAll();
+  }
+  pool.waitForDone();
+  out.flush();
+
+  const double seconds = wall.nsecsElapsed() / 1e9;
+  err << "deals       " << count << "  (" << qint64(count / seconds)
+      << " deals/s)" << Qt::endl
+      << "solvable    " << counts[int(Solvability::Solvable)] << Qt::endl
+      << "unsolvable  " << counts[int(Solvability::Unsolvable)] << Qt::endl
+      << "unknown     " << counts[int(Solvability::Unknown)] << Qt::endl
+      << "nodes       " << nodes << Qt::endl
+      << "table       " << table.hits << " hits, " << table.misses()
+      << " misses, " << table.collisions << " collisions" << Qt::endl;
+  if (opt.beam) {
+    err << "beam solved " << beamSolved << Qt::endl
+        << "agreement   " << agreed << " of " << decided << " decided deals";
+    if (decided > 0)
+      err << "  (" << QString::number(100.0 * agreed / decided, 'f', 1)
+          << "%)";
+    err << Qt::endl;
+  }
+  return true;
+}
+
+#endif  // VERIFY_HPP